@@ -0,0 +1,33 @@
+    { "INF_SUCCESS", INF_SUCCESS },
+    { "WRN_TRUNCATED", WRN_TRUNCATED },
+    { "ERR_INVALID_FLAGS", ERR_INVALID_FLAGS },
+    { "ERR_NO_DATA", ERR_NO_DATA },
+    { "ERR_NO_MEMORY", ERR_NO_MEMORY },
+    { "ERR_INVALID_PARAMETER", ERR_INVALID_PARAMETER },
+    { "ERR_BUFFER_OVERFLOW", ERR_BUFFER_OVERFLOW },
+    { "ERR_DUPLICATE_OPERATOR", ERR_DUPLICATE_OPERATOR },
+    { "ERR_CONFLICTING_OPERATORS", ERR_CONFLICTING_OPERATORS },
+    { "ERR_INVALID_OPERATOR", ERR_INVALID_OPERATOR },
+    { "ERR_INVALID_FUNCTOR", ERR_INVALID_FUNCTOR },
+    { "ERR_DUPLICATE_FUNCTOR", ERR_DUPLICATE_FUNCTOR },
+    { "ERR_SYNTAX_ERROR", ERR_SYNTAX_ERROR },
+    { "ERR_INVALID_RPN", ERR_INVALID_RPN },
+    { "ERR_INVALID_EXPRESSION", ERR_INVALID_EXPRESSION },
+    { "ERR_VARIABLE_NAME_TOO_LONG", ERR_VARIABLE_NAME_TOO_LONG },
+    { "ERR_INVALID_VARIABLE_NAME", ERR_INVALID_VARIABLE_NAME },
+    { "ERR_UNDEFINED_VARIABLE", ERR_UNDEFINED_VARIABLE },
+    { "ERR_UNBALANCED_PARENTHESIS", ERR_UNBALANCED_PARENTHESIS },
+    { "ERR_MISSING_BASIC_OPERATOR", ERR_MISSING_BASIC_OPERATOR },
+    { "ERR_UNEXPECTED_PARENTHESIS_SEPARATOR", ERR_UNEXPECTED_PARENTHESIS_SEPARATOR },
+    { "ERR_TOO_MANY_PARAMETERS", ERR_TOO_MANY_PARAMETERS },
+    { "ERR_TOO_FEW_PARAMETERS", ERR_TOO_FEW_PARAMETERS },
+    { "ERR_INVALID_ASSIGNMENT", ERR_INVALID_ASSIGNMENT },
+    { "ERR_CIRCULAR_DEPENDENCY", ERR_CIRCULAR_DEPENDENCY },
+    { "ERR_INVALID_ATOM_TYPE_FOR_OPERATION", ERR_INVALID_ATOM_TYPE_FOR_OPERATION },
+    { "ERR_UNPARSED_EXPRESSION", ERR_UNPARSED_EXPRESSION },
+    { "ERR_NOT_INITIALIZED", ERR_NOT_INITIALIZED },
+    { "ERR_BAD_MAGIC", ERR_BAD_MAGIC },
+    { "ERR_NOT_SUPPORTED", ERR_NOT_SUPPORTED },
+    { "ERR_UNDEFINED", ERR_UNDEFINED },
+    { "ERR_GENERAL_FAILURE", ERR_GENERAL_FAILURE },
+    { "ERR_UNDEFINED_BEHAVIOUR", ERR_UNDEFINED_BEHAVIOUR },
@@ -20,6 +20,8 @@
  */
 
 #include "XEvaluator.h"
+#include "XAtom.h"
+#include "XProgram.h"
 #include "ConsoleIO.h"
 #include "XErrors.h"
 #include "XGenericDefs.h"
@@ -32,13 +34,29 @@ int main(int argc, char **argv)
     int rc = Eval.Init();
     if (IS_SUCCESS(rc))
     {
-        rc = Eval.Parse("1 + 42 + 10");
+        XProgram *pProgram = NULL;
+        rc = Eval.Parse("1 + 42 + 10", &pProgram);
         if (IS_FAILURE(rc))
             Console.ErrorPrintf(rc, "Parsing failed.\n");
         else
         {
             Console.Printf("Parsing successful.\n");
-            Eval.Evaluate();
+
+            /*
+             * Parse once, evaluate many.
+             */
+            for (unsigned i = 0; i < 2; i++)
+            {
+                XAtom Result;
+                rc = Eval.Evaluate(pProgram, &Result);
+                if (IS_FAILURE(rc))
+                {
+                    Console.ErrorPrintf(rc, "Evaluation failed.\n");
+                    break;
+                }
+                Console.Printf("%s\n", Result.PrintToString().c_str());
+            }
+            delete pProgram;
         }
     }
     else
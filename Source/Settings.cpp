@@ -70,7 +70,7 @@ Settings::~Settings()
 #define SETTINGS_SETTYPE(typedesc, type) \
 int Settings::Set##typedesc(std::string sKey, type Val) \
 { \
-    m_Map.insert(KeyValue(sKey, SettingsValue(Val))); \
+    m_Map[sKey] = SettingsValue(Val); \
     return INF_SUCCESS; \
 } \
 
@@ -28,13 +28,75 @@
 #include "XVariable.h"
 #include "XErrors.h"
 
+#include <climits>
 #include <cstring>
+#include <sstream>
+#include <vector>
+
+
+/**
+ * Sets a GMP integer from a signed 64-bit integer. GMP only deals in longs which
+ * are 32-bit on some hosts (e.g. Windows).
+ *
+ * @param Integer           The GMP integer to set.
+ * @param iValue            The value.
+ */
+static void MpzSetS64(mpz_t Integer, int64_t iValue)
+{
+#if LONG_MAX >= INT64_MAX
+    mpz_set_si(Integer, (long)iValue);
+#else
+    /* Split into a signed high and an unsigned low half, value = High * 2^32 + Low. */
+    mpz_set_si(Integer, (long)(iValue >> 32));
+    mpz_mul_2exp(Integer, Integer, 32);
+    mpz_add_ui(Integer, Integer, (unsigned long)(iValue & UINT32_MAX));
+#endif
+}
+
+
+/**
+ * Gets a GMP integer as a signed 64-bit integer if it fits.
+ *
+ * @param Integer           The GMP integer.
+ * @param piValue           Where to store the value.
+ *
+ * @return bool: true if the value fits and was stored, false otherwise.
+ */
+static bool MpzGetS64(const mpz_t Integer, int64_t *piValue)
+{
+#if LONG_MAX >= INT64_MAX
+    if (!mpz_fits_slong_p(Integer))
+        return false;
+    *piValue = mpz_get_si(Integer);
+    return true;
+#else
+    if (mpz_sizeinbase(Integer, 2) > 64)
+        return false;
+    uint64_t uMagnitude = 0;
+    mpz_export(&uMagnitude, NULL, -1, sizeof(uMagnitude), 0, 0, Integer);
+    if (mpz_sgn(Integer) < 0)
+    {
+        if (uMagnitude > (uint64_t)INT64_MAX + 1)
+            return false;
+        *piValue = uMagnitude == (uint64_t)INT64_MAX + 1 ? INT64_MIN : -(int64_t)uMagnitude;
+    }
+    else
+    {
+        if (uMagnitude > (uint64_t)INT64_MAX)
+            return false;
+        *piValue = (int64_t)uMagnitude;
+    }
+    return true;
+#endif
+}
 
 XAtom::XAtom()
     : m_AtomType(enmAtomTypeEmpty),
-    m_iPosition(0),
-    m_cParams(0)
+    m_fSmall(false),
+    m_uReserved(0),
+    m_uPosition(0)
 {
+    AssertCompile(sizeof(XAtom) <= 32);     /* Two Atoms per cache line. */
     std::memset(&m_u, 0, sizeof(m_u));
 }
 
@@ -51,6 +113,43 @@ XAtom::~XAtom()
 }
 
 
+XAtom &XAtom::operator =(const XAtom &Atom)
+{
+    if (this == &Atom)
+        return *this;
+
+    /*
+     * Copy big integers and floats into the limbs we already have where possible.
+     */
+    if (   IsInteger() && !m_fSmall
+        && Atom.IsInteger() && !Atom.m_fSmall)
+        mpz_set(m_u.Integer, Atom.m_u.Integer);
+    else if (   IsFloat()
+             && Atom.IsFloat()
+             && mpf_get_prec(m_u.Float) == mpf_get_prec(Atom.m_u.Float))
+        mpf_set(m_u.Float, Atom.m_u.Float);
+    else
+    {
+        Destroy();
+        SetTo(Atom);
+        return *this;
+    }
+    m_uReserved = Atom.m_uReserved;
+    m_uPosition = Atom.m_uPosition;
+    return *this;
+}
+
+
+void XAtom::Swap(XAtom &Atom)
+{
+    /* Atoms are trivially relocatable, see the class description. */
+    char abTmp[sizeof(XAtom)];
+    std::memcpy(abTmp, &Atom, sizeof(XAtom));
+    std::memcpy((void *)&Atom, this, sizeof(XAtom));
+    std::memcpy((void *)this, abTmp, sizeof(XAtom));
+}
+
+
 bool XAtom::IsFunction() const
 {
     return m_AtomType == enmAtomTypeFunction;
@@ -80,6 +179,12 @@ bool XAtom::IsInteger() const
     return m_AtomType == enmAtomTypeInteger;
 }
 
+bool XAtom::IsSmallInteger() const
+{
+    return m_AtomType == enmAtomTypeInteger && m_fSmall;
+}
+
+
 bool XAtom::IsFloat() const
 {
     return m_AtomType == enmAtomTypeFloat;
@@ -88,7 +193,7 @@ bool XAtom::IsFloat() const
 
 XAtomType XAtom::Type() const
 {
-    return m_AtomType;
+    return (XAtomType)m_AtomType;
 }
 
 
@@ -96,15 +201,62 @@ int XAtom::GetInteger(mpz_t Result) const
 {
     if (m_AtomType == enmAtomTypeInteger)
     {
-        mpz_set(Result, m_u.Integer);
+        if (m_fSmall)
+            MpzSetS64(Result, m_u.iSmall);
+        else
+            mpz_set(Result, m_u.Integer);
         return INF_SUCCESS;
     }
     return ERR_INVALID_ATOM_TYPE_FOR_OPERATION;
 }
 
 
+int64_t XAtom::SmallInteger() const
+{
+    Assert(IsSmallInteger());
+    return m_u.iSmall;
+}
+
+
+int XAtom::SetSmallInteger(int64_t iValue)
+{
+    Destroy();
+    m_u.iSmall = iValue;
+    m_fSmall   = true;
+    m_AtomType = enmAtomTypeInteger;
+    return INF_SUCCESS;
+}
+
+
 int XAtom::SetIntegerFromStr(const char *pcszStr, int iRadix)
 {
+    /*
+     * Accumulate natively while the value fits, which is almost always.
+     */
+    const uint64_t uLimit = (uint64_t)INT64_MAX;
+    uint64_t uValue = 0;
+    const char *pcsz = pcszStr;
+    for (; *pcsz; pcsz++)
+    {
+        const char ch = *pcsz;
+        unsigned uDigit;
+        if (ch >= '0' && ch <= '9')
+            uDigit = ch - '0';
+        else if (ch >= 'a' && ch <= 'z')
+            uDigit = ch - 'a' + 10;
+        else if (ch >= 'A' && ch <= 'Z')
+            uDigit = ch - 'A' + 10;
+        else
+            break;
+        if (   uDigit >= (unsigned)iRadix
+            || uValue > (uLimit - uDigit) / (unsigned)iRadix)
+            break;
+        uValue = uValue * iRadix + uDigit;
+    }
+    if (   !*pcsz
+        && pcsz != pcszStr)
+        return SetSmallInteger((int64_t)uValue);
+
     Destroy();
     mpz_init_set_str(m_u.Integer, pcszStr, iRadix);
     m_AtomType = enmAtomTypeInteger;
@@ -112,8 +264,159 @@ int XAtom::SetIntegerFromStr(const char *pcszStr, int iRadix)
 }
 
 
+/**
+ * Appends bits above the bits already accumulated, flushing full limbs.
+ *
+ * @param paLimbs           The limb array.
+ * @param pidxLimb          Index of the next limb to flush to.
+ * @param puLimb            The limb being accumulated.
+ * @param pcBits            Number of bits accumulated in @a puLimb.
+ * @param uValue            The bits to append.
+ * @param cValueBits        Number of bits in @a uValue, at most 32.
+ */
+static inline void AppendBits(mp_limb_t *paLimbs, size_t *pidxLimb, mp_limb_t *puLimb, unsigned *pcBits,
+                              uint64_t uValue, unsigned cValueBits)
+{
+    *puLimb |= (mp_limb_t)(uValue << *pcBits);
+    *pcBits += cValueBits;
+    if (*pcBits >= GMP_NUMB_BITS)
+    {
+        paLimbs[(*pidxLimb)++] = *puLimb;
+        *pcBits -= GMP_NUMB_BITS;
+        /* Carry over the bits that didn't fit. */
+        *puLimb = *pcBits ? (mp_limb_t)(uValue >> (cValueBits - *pcBits)) : 0;
+    }
+}
+
+
+/**
+ * Loads 8 bytes as a little-endian 64-bit value regardless of host byte order.
+ */
+static inline uint64_t LoadLE64(const char *pch)
+{
+    const unsigned char *pb = (const unsigned char *)pch;
+    return  (uint64_t)pb[0]        | ((uint64_t)pb[1] << 8)  | ((uint64_t)pb[2] << 16) | ((uint64_t)pb[3] << 24)
+          | ((uint64_t)pb[4] << 32) | ((uint64_t)pb[5] << 40) | ((uint64_t)pb[6] << 48) | ((uint64_t)pb[7] << 56);
+}
+
+
+/**
+ * Packs digits in a power-of-two radix into limbs, least significant limb first.
+ *
+ * Hexadecimal digits are converted 8 at a time within a 64-bit word (SWAR): each
+ * character is turned into its nibble and the 8 nibbles are folded into 32 bits
+ * without any per-character branches.
+ *
+ * @return size_t: Number of limbs written.
+ */
+static size_t PackPow2Digits(mp_limb_t *paLimbs, const char *pchDigits, size_t cDigits, unsigned cBitsPerDigit)
+{
+    size_t idxLimb  = 0;
+    mp_limb_t uLimb = 0;
+    unsigned cBits  = 0;
+    const char *pch = pchDigits + cDigits;  /* Least significant digit is last. */
+
+    if (cBitsPerDigit == 4)
+    {
+        while (pch - pchDigits >= 8)
+        {
+            pch -= 8;
+            uint64_t u = LoadLE64(pch);         /* Byte 0 holds the most significant digit. */
+
+            /* '0'-'9' have bit 6 clear, 'a'-'f' and 'A'-'F' have it set and their low nibble is 1-6. */
+            u = (u & UINT64_C(0x0f0f0f0f0f0f0f0f)) + ((u >> 6) & UINT64_C(0x0101010101010101)) * 9;
+
+            /* Fold the nibbles, most significant byte first, into a 32-bit value. */
+            u = ((u & UINT64_C(0x000f000f000f000f)) << 4)  | ((u >> 8)  & UINT64_C(0x000f000f000f000f));
+            u = ((u & UINT64_C(0x000000ff000000ff)) << 8)  | ((u >> 16) & UINT64_C(0x000000ff000000ff));
+            u = ((u & UINT64_C(0x000000000000ffff)) << 16) | ((u >> 32) & UINT64_C(0x000000000000ffff));
+            AppendBits(paLimbs, &idxLimb, &uLimb, &cBits, u, 32);
+        }
+    }
+
+    while (pch > pchDigits)
+    {
+        const char ch = *--pch;
+        unsigned uDigit;
+        if (ch >= '0' && ch <= '9')
+            uDigit = ch - '0';
+        else if (ch >= 'a' && ch <= 'f')
+            uDigit = ch - 'a' + 10;
+        else
+        {
+            Assert(ch >= 'A' && ch <= 'F');
+            uDigit = ch - 'A' + 10;
+        }
+        Assert(uDigit < (1U << cBitsPerDigit));
+        AppendBits(paLimbs, &idxLimb, &uLimb, &cBits, uDigit, cBitsPerDigit);
+    }
+
+    if (cBits)
+        paLimbs[idxLimb++] = uLimb;
+    return idxLimb;
+}
+
+
+int XAtom::SetIntegerFromPow2Digits(const char *pchDigits, size_t cDigits, unsigned cBitsPerDigit)
+{
+    AssertReturn(cDigits > 0, ERR_INVALID_PARAMETER);
+    AssertReturn(cBitsPerDigit >= 1 && cBitsPerDigit <= 4, ERR_INVALID_PARAMETER);
+
+    /* Skip leading zeros so small values with padding still end up inline. */
+    while (   cDigits > 1
+           && *pchDigits == '0')
+    {
+        ++pchDigits;
+        --cDigits;
+    }
+
+    /* Inline if the value fits, i.e. its significant bits, not counting the leading digit's zero bits, are below 64. */
+    const size_t cBits = cDigits * cBitsPerDigit;
+    const unsigned uLeadingDigit = *pchDigits <= '9' ? *pchDigits - '0' : (*pchDigits | 0x20) - 'a' + 10;
+    size_t cValueBits = cBits - cBitsPerDigit;
+    for (unsigned uDigit = uLeadingDigit; uDigit; uDigit >>= 1)
+        ++cValueBits;
+    if (cValueBits < 64)
+    {
+        uint64_t uValue = 0;
+        for (size_t i = 0; i < cDigits; i++)
+        {
+            const char ch = pchDigits[i];
+            const unsigned uDigit = ch <= '9' ? ch - '0' : (ch | 0x20) - 'a' + 10;
+            uValue = (uValue << cBitsPerDigit) | uDigit;
+        }
+        return SetSmallInteger((int64_t)uValue);
+    }
+
+    Destroy();
+    const size_t cLimbs = (cBits + GMP_NUMB_BITS - 1) / GMP_NUMB_BITS;
+    mpz_init2(m_u.Integer, cBits);
+    m_AtomType = enmAtomTypeInteger;
+
+#if __GNU_MP_VERSION >= 6
+    /* Write straight into the integer's limbs, the high limbs may be zero, they're normalized. */
+    mp_limb_t *paLimbs = mpz_limbs_write(m_u.Integer, cLimbs);
+    const size_t cPacked = PackPow2Digits(paLimbs, pchDigits, cDigits, cBitsPerDigit);
+    Assert(cPacked == cLimbs);
+    mpz_limbs_finish(m_u.Integer, cPacked);
+#else
+    /* No direct limb access (e.g. older MPIR), pack into a temporary array and import it. */
+    std::vector<mp_limb_t> Limbs(cLimbs);
+    const size_t cPacked = PackPow2Digits(&Limbs[0], pchDigits, cDigits, cBitsPerDigit);
+    Assert(cPacked == cLimbs);
+    mpz_import(m_u.Integer, cPacked, -1 /* least significant first */, sizeof(mp_limb_t), 0 /* native endian */,
+               0 /* nails */, &Limbs[0]);
+#endif
+    return INF_SUCCESS;
+}
+
+
 int XAtom::SetInteger(mpz_t Source)
 {
+    int64_t iValue;
+    if (MpzGetS64(Source, &iValue))
+        return SetSmallInteger(iValue);
+
     Destroy();
     mpz_init_set(m_u.Integer, Source);
     m_AtomType = enmAtomTypeInteger;
@@ -121,6 +424,45 @@ int XAtom::SetInteger(mpz_t Source)
 }
 
 
+mpz_srcptr XAtom::BigInteger() const
+{
+    Assert(m_AtomType == enmAtomTypeInteger && !m_fSmall);
+    return m_u.Integer;
+}
+
+
+mpz_ptr XAtom::MutableInteger()
+{
+    if (m_AtomType == enmAtomTypeInteger)
+    {
+        if (m_fSmall)
+        {
+            const int64_t iValue = m_u.iSmall;
+            mpz_init(m_u.Integer);
+            MpzSetS64(m_u.Integer, iValue);
+            m_fSmall = false;
+        }
+    }
+    else
+    {
+        Destroy();
+        mpz_init(m_u.Integer);
+        m_AtomType = enmAtomTypeInteger;
+    }
+    return m_u.Integer;
+}
+
+
+void XAtom::NormalizeInteger()
+{
+    int64_t iValue;
+    if (   m_AtomType == enmAtomTypeInteger
+        && !m_fSmall
+        && MpzGetS64(m_u.Integer, &iValue))
+        SetSmallInteger(iValue);
+}
+
+
 int XAtom::GetFloat(mpf_t Result) const
 {
     if (m_AtomType == enmAtomTypeFloat)
@@ -136,23 +478,69 @@ int XAtom::PromoteGetFloat(mpf_t Result) const
 {
     if (m_AtomType == enmAtomTypeFloat)
         return GetFloat(Result);
-    else
+    else if (m_AtomType == enmAtomTypeInteger)
     {
-        mpf_set_z(Result, m_u.Integer);
+        if (!m_fSmall)
+            mpf_set_z(Result, m_u.Integer);
+#if LONG_MAX >= INT64_MAX
+        else
+            mpf_set_si(Result, (long)m_u.iSmall);
+#else
+        else
+        {
+            /* See MpzSetS64(). */
+            mpf_set_si(Result, (long)(m_u.iSmall >> 32));
+            mpf_mul_2exp(Result, Result, 32);
+            mpf_add_ui(Result, Result, (unsigned long)(m_u.iSmall & UINT32_MAX));
+        }
+#endif
         return INF_SUCCESS;
     }
+    return ERR_INVALID_ATOM_TYPE_FOR_OPERATION;
 }
 
 
-int XAtom::SetFloatFromStr(const char *pcszStr, int iRadix)
+int XAtom::SetFloatFromStr(const char *pcszStr, int iRadix, mp_bitcnt_t cBits)
 {
     Destroy();
-    mpf_init_set_str(m_u.Float, pcszStr, iRadix);
+    if (cBits)
+    {
+        mpf_init2(m_u.Float, cBits);
+        mpf_set_str(m_u.Float, pcszStr, iRadix);
+    }
+    else
+        mpf_init_set_str(m_u.Float, pcszStr, iRadix);
     m_AtomType = enmAtomTypeFloat;
     return INF_SUCCESS;
 }
 
 
+mpf_srcptr XAtom::Float() const
+{
+    Assert(m_AtomType == enmAtomTypeFloat);
+    return m_u.Float;
+}
+
+
+mpf_ptr XAtom::MutableFloat(mp_bitcnt_t cBits)
+{
+    if (m_AtomType == enmAtomTypeFloat)
+        return m_u.Float;
+
+    mpf_t Float;
+    if (cBits)
+        mpf_init2(Float, cBits);
+    else
+        mpf_init(Float);
+    if (m_AtomType == enmAtomTypeInteger)
+        PromoteGetFloat(Float);
+    Destroy();
+    std::memcpy(&m_u.Float, &Float, sizeof(Float));     /* Take over the limbs. */
+    m_AtomType = enmAtomTypeFloat;
+    return m_u.Float;
+}
+
+
 int XAtom::SetFloat(mpf_t Source)
 {
     Destroy();
@@ -181,7 +569,7 @@ int XAtom::SetOperator(const XOperator *pOperator)
 const XFunction *XAtom::Function() const
 {
     if (m_AtomType == enmAtomTypeFunction)
-        return m_u.pFunction;
+        return m_u.Fn.pFunction;
     return NULL;
 }
 
@@ -189,7 +577,8 @@ const XFunction *XAtom::Function() const
 int XAtom::SetFunction(const XFunction *pFunction)
 {
     Destroy();
-    m_u.pFunction = pFunction;
+    m_u.Fn.pFunction = pFunction;
+    m_u.Fn.cParams   = 0;
     m_AtomType = enmAtomTypeFunction;
     return INF_SUCCESS;
 }
@@ -215,10 +604,19 @@ int XAtom::SetVariable(XVariable *pVariable)
 void XAtom::SetTo(const XAtom &atom)
 {
     m_AtomType  = atom.m_AtomType;
-    m_cParams   = atom.m_cParams;
-    m_iPosition = atom.m_iPosition;
-    m_sVariable = atom.m_sVariable;
-    m_u         = atom.m_u;
+    m_fSmall    = atom.m_fSmall;
+    m_uReserved = atom.m_uReserved;
+    m_uPosition = atom.m_uPosition;
+    if (   m_AtomType == enmAtomTypeInteger
+        && !m_fSmall)
+        mpz_init_set(m_u.Integer, atom.m_u.Integer);
+    else if (m_AtomType == enmAtomTypeFloat)
+    {
+        mpf_init2(m_u.Float, mpf_get_prec(atom.m_u.Float));
+        mpf_set(m_u.Float, atom.m_u.Float);
+    }
+    else
+        m_u = atom.m_u;
 }
 
 
@@ -226,25 +624,27 @@ void XAtom::Destroy()
 {
     if (m_AtomType == enmAtomTypeFloat)
         mpf_clear(m_u.Float);
-    else if (m_AtomType == enmAtomTypeInteger)
+    else if (   m_AtomType == enmAtomTypeInteger
+             && !m_fSmall)
         mpz_clear(m_u.Integer);
 
     std::memset(&m_u, 0, sizeof(m_u));
     m_AtomType = enmAtomTypeEmpty;
+    m_fSmall   = false;
 }
 
 
 void XAtom::IncrementFunctionParams()
 {
     if (m_AtomType == enmAtomTypeFunction)
-        m_cParams++;
+        m_u.Fn.cParams++;
 }
 
 
 uint64_t XAtom::FunctionParams() const
 {
     if (m_AtomType == enmAtomTypeFunction)
-        return m_cParams;
+        return m_u.Fn.cParams;
     return UINT64_MAX;
 }
 
@@ -264,6 +664,13 @@ std::string XAtom::PrintToString() const
         case enmAtomTypeInteger:
         {
             sOut += "Int: ";
+            if (m_fSmall)
+            {
+                std::ostringstream sValue;
+                sValue << m_u.iSmall;
+                sOut += sValue.str();
+                break;
+            }
             char *pszBuf = NULL;
             int rc = gmp_asprintf(&pszBuf, "%Zd", m_u.Integer);
             if (rc > 0)
@@ -296,7 +703,7 @@ std::string XAtom::PrintToString() const
         case enmAtomTypeFunction:
         {
             sOut += "Function: ";
-            sOut += m_u.pFunction ? m_u.pFunction->Name() : "NULL";
+            sOut += m_u.Fn.pFunction ? m_u.Fn.pFunction->Name() : "NULL";
             break;
         }
 
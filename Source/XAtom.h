@@ -58,13 +58,36 @@ enum XAtomType
  * An Atom represents the smallest unit of parsing.
  * The Atom class represents a token of the unit parsing stage
  * of the Evaluator class.
+ *
+ * Atoms are compact, the type, flags and position share one word and the
+ * value lives in a union. They hold no pointers to themselves and are not
+ * polymorphic, so they're trivially relocatable: an Atom may be moved with
+ * memcpy as long as only the destination is destructed afterwards.
  */
 class XAtom
 {
     public:
         XAtom();
         XAtom(const XAtom &a_Atom);
-        virtual ~XAtom();
+        ~XAtom();
+
+        /**
+         * Assignment operator, makes a deep copy of the number value if any. Big
+         * integers and floats are copied into this Atom's limbs when it already
+         * has some of the same kind.
+         *
+         * @param Atom              Atom to copy.
+         *
+         * @return XAtom&: Reference to this Atom.
+         */
+        XAtom                      &operator =(const XAtom &Atom);
+
+        /**
+         * Swaps the contents of two Atoms, number values are not copied.
+         *
+         * @param Atom              Atom to swap with.
+         */
+        void                        Swap(XAtom &Atom);
 
         /**
          * Returns the type of this Atom.
@@ -87,6 +110,15 @@ class XAtom
          */
         bool                        IsInteger() const;
 
+        /**
+         * Returns if this Atom is an integer number small enough to be held inline as
+         * a signed 64-bit integer. Integer Atoms are kept in this form whenever their
+         * value fits, only larger values use GMP.
+         *
+         * @return bool: true if it's a small integer number, false otherwise.
+         */
+        bool                        IsSmallInteger() const;
+
         /**
          * Returns if this Atom is a floating point number.
          *
@@ -124,6 +156,22 @@ class XAtom
          */
         int                         GetInteger(mpz_t Result) const;
 
+        /**
+         * Returns the value of a small Integer Atom.
+         *
+         * @return int64_t: The integer value, undefined if this is not a small Integer Atom.
+         */
+        int64_t                     SmallInteger() const;
+
+        /**
+         * Sets a small integer value for this Atom making it an Integer Atom.
+         *
+         * @param iValue            The integer value.
+         *
+         * @return int: xank error code.
+         */
+        int                         SetSmallInteger(int64_t iValue);
+
         /**
          * Sets the integer value from a string.
          *
@@ -134,6 +182,19 @@ class XAtom
          */
         int                         SetIntegerFromStr(const char *pcszStr, int iRadix);
 
+        /**
+         * Sets the integer value from digits in a power-of-two radix (2, 8 or 16),
+         * packing the digits directly into limbs.
+         *
+         * @param pchDigits         The digits, need not be zero terminated. Must
+         *                          contain only valid digits for the radix.
+         * @param cDigits           Number of digits in @a pchDigits, at least 1.
+         * @param cBitsPerDigit     Number of bits per digit, i.e. log2 of the radix.
+         *
+         * @return int: xank error code.
+         */
+        int                         SetIntegerFromPow2Digits(const char *pchDigits, size_t cDigits, unsigned cBitsPerDigit);
+
         /**
          * Sets the integer value for this Atom making it an Integer Atom.
          * @param Source            The integer value to assign to this Atom.
@@ -142,6 +203,28 @@ class XAtom
          */
         int                         SetInteger(mpz_t Source);
 
+        /**
+         * Returns the GMP integer of a big (i.e. not small) Integer Atom for reading
+         * in place.
+         *
+         * @return mpz_srcptr: The integer, undefined if this is not a big Integer Atom.
+         */
+        mpz_srcptr                  BigInteger() const;
+
+        /**
+         * Makes this a big Integer Atom, keeping its value if it's already an Integer
+         * Atom, and returns its GMP integer for writing in place. An Atom that's
+         * already a big integer keeps its limbs. Call NormalizeInteger() once done.
+         *
+         * @return mpz_ptr: The integer.
+         */
+        mpz_ptr                     MutableInteger();
+
+        /**
+         * Moves the value of a big Integer Atom inline if it fits a small integer.
+         */
+        void                        NormalizeInteger();
+
         /**
          * Gets the floating point value for this Float Atom.
          *
@@ -166,10 +249,30 @@ class XAtom
          * @param pcszStr           The string representation of the floating point
          *                          value.
          * @param iRadix            The radix of the floating point value in @a pcszStr.
+         * @param cBits             The precision in bits, 0 for the GMP default precision.
          *
          * @return int: xank error code.
          */
-        int                         SetFloatFromStr(const char *pcszStr, int iRadix);
+        int                         SetFloatFromStr(const char *pcszStr, int iRadix, mp_bitcnt_t cBits);
+
+        /**
+         * Returns the GMP float of a Float Atom for reading in place.
+         *
+         * @return mpf_srcptr: The float, undefined if this is not a Float Atom.
+         */
+        mpf_srcptr                  Float() const;
+
+        /**
+         * Makes this a Float Atom, promoting the value of an Integer Atom, and returns
+         * its GMP float for writing in place. An Atom that's already a float keeps
+         * its limbs and precision.
+         *
+         * @param cBits             The precision to promote with, 0 for the GMP default
+         *                          precision.
+         *
+         * @return mpf_ptr: The float.
+         */
+        mpf_ptr                     MutableFloat(mp_bitcnt_t cBits);
 
         /**
          * Sets the floating point value for this Atom making it a Float atom.
@@ -254,7 +357,8 @@ class XAtom
 
     private:
         /**
-         * Sets this Atom to be identical to the passed in Atom.
+         * Sets this Atom to be identical to the passed in Atom. Number values are
+         * deep copied so both Atoms can be destroyed independently.
          *
          * @param Atom          The source Atom.
          */
@@ -265,17 +369,22 @@ class XAtom
          */
         void                        Destroy();
 
-        XAtomType                   m_AtomType;   /**< The type this Atom represents. */
-        uint64_t                    m_iPosition;  /**< Cursor position, an index used to associate an Atom with an error. */
-        uint64_t                    m_cParams;    /**< Number of parameters if this is a Function Atom. */
-        std::string                 m_sVariable;  /**< Name of the variable if this is/might become a Variable Atom. */
+        uint8_t                     m_AtomType;   /**< The type this Atom represents, an XAtomType. */
+        bool                        m_fSmall;     /**< Whether an Integer Atom holds its value in iSmall rather than Integer. */
+        uint16_t                    m_uReserved;  /**< Reserved, keeps the header one word. */
+        uint32_t                    m_uPosition;  /**< Cursor position, an index used to associate an Atom with an error. */
         union
         {
             mpf_t                   Float;        /**< Float point value for a Number Atom. */
             mpz_t                   Integer;      /**< Integer value for a Number Atom. */
+            int64_t                 iSmall;       /**< Integer value for a small Integer Number Atom. */
             const XOperator        *pOperator;    /**< Pointer to the Operator for an Operator Atom. */
-            const XFunction        *pFunction;    /**< Pointer to the Function for a Function Atom. */
-            const XVariable        *pVariable;    /**< Pointer to the Variable for a Variable Atom. */
+            struct
+            {
+                const XFunction    *pFunction;    /**< Pointer to the Function for a Function Atom. */
+                uint64_t            cParams;      /**< Number of parameters to the Function. */
+            } Fn;
+            const XVariable        *pVariable;    /**< Pointer to the Variable for a Variable Atom, which holds the name. */
         } m_u;
 };
 
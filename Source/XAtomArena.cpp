@@ -0,0 +1,108 @@
+/** @file
+ * xank - Atom Arena, implementation.
+ */
+
+/*
+ * Copyright (C) 2012 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "XAtomArena.h"
+#include "XAtom.h"
+#include "Assert.h"
+
+#include <new>
+
+/**
+ * An arena slot, an Atom and the link to the previously registered owner. The Atom
+ * comes first so a pointer to it is a pointer to its slot.
+ */
+struct XAtomArena::Slot
+{
+    XAtom                   Atom;
+    Slot                   *pNextOwner;
+};
+
+
+XAtomArena::XAtomArena()
+    : m_idxBlock(0),
+    m_cUsed(0),
+    m_pOwners(NULL)
+{
+}
+
+
+XAtomArena::~XAtomArena()
+{
+    Reset();
+    for (size_t i = 0; i < m_apvBlocks.size(); i++)
+        ::operator delete(m_apvBlocks[i]);
+}
+
+
+XAtom *XAtomArena::Alloc()
+{
+    if (   m_idxBlock < m_apvBlocks.size()
+        && m_cUsed == XANK_ATOM_ARENA_BLOCK_ATOMS)
+    {
+        ++m_idxBlock;
+        m_cUsed = 0;
+    }
+
+    if (m_idxBlock == m_apvBlocks.size())
+    {
+        void *pvBlock = ::operator new(sizeof(Slot) * XANK_ATOM_ARENA_BLOCK_ATOMS, std::nothrow);
+        if (!pvBlock)
+            return NULL;
+        m_apvBlocks.push_back(pvBlock);
+        m_cUsed = 0;
+    }
+
+    Slot *pSlot = (Slot *)m_apvBlocks[m_idxBlock] + m_cUsed;
+    ++m_cUsed;
+    return new(&pSlot->Atom) XAtom;
+}
+
+
+void XAtomArena::TrackOwner(XAtom *pAtom)
+{
+    Assert(pAtom);
+    Slot *pSlot       = (Slot *)pAtom;
+    pSlot->pNextOwner = m_pOwners;
+    m_pOwners         = pSlot;
+}
+
+
+void XAtomArena::Reset()
+{
+    for (Slot *pSlot = m_pOwners; pSlot; pSlot = pSlot->pNextOwner)
+        pSlot->Atom.~XAtom();
+    m_pOwners  = NULL;
+    m_idxBlock = 0;
+    m_cUsed    = 0;
+}
+
+
+void XAtomArena::ResetHandedOver()
+{
+#ifdef XANK_DEBUG
+    for (Slot *pSlot = m_pOwners; pSlot; pSlot = pSlot->pNextOwner)
+        Assert(!pSlot->Atom.IsNumber() || pSlot->Atom.IsSmallInteger());
+#endif
+    m_pOwners  = NULL;
+    m_idxBlock = 0;
+    m_cUsed    = 0;
+}
+
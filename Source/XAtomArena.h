@@ -0,0 +1,93 @@
+/** @file
+ * xank - Atom Arena, header.
+ */
+
+/*
+ * Copyright (C) 2012 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XANK_ATOM_ARENA_H
+# define XANK_ATOM_ARENA_H
+
+#include <cstddef>
+
+#include <vector>
+
+class XAtom;
+
+/** Number of Atoms per arena block. */
+#define XANK_ATOM_ARENA_BLOCK_ATOMS             64
+
+/**
+ * An Atom Arena.
+ * A bump allocator for the Atoms of a single parse. Atoms are never freed
+ * individually, Reset() releases all of them at once and keeps the blocks for
+ * the next parse.
+ *
+ * Atoms are not destructed on Reset() unless they were registered with
+ * TrackOwner(), which must be done for every Atom holding GMP memory. The
+ * registered Atoms are linked through their slots, so registering never
+ * allocates. Releasing is O(1) once the GMP memory was handed over, see
+ * ResetHandedOver(), otherwise each registered Atom must be destructed.
+ */
+class XAtomArena
+{
+    public:
+        XAtomArena();
+        virtual ~XAtomArena();
+
+        /**
+         * Allocates an empty Atom.
+         *
+         * @return XAtom*: The Atom, NULL if out of memory.
+         */
+        XAtom                      *Alloc();
+
+        /**
+         * Registers an Atom allocated from this arena as holding GMP memory so that
+         * Reset() destructs it. Never fails.
+         *
+         * @param pAtom             The Atom.
+         */
+        void                        TrackOwner(XAtom *pAtom);
+
+        /**
+         * Releases all Atoms allocated from this arena. Only Atoms registered with
+         * TrackOwner() are destructed, the blocks are kept.
+         */
+        void                        Reset();
+
+        /**
+         * Releases all Atoms allocated from this arena in O(1), when the values of the
+         * Atoms registered with TrackOwner() were all handed over, e.g. swapped into a
+         * Program, so none of them holds GMP memory anymore.
+         */
+        void                        ResetHandedOver();
+
+    private:
+        XAtomArena(const XAtomArena &);             /* Not copyable. */
+        XAtomArena &operator =(const XAtomArena &); /* Not assignable. */
+
+        struct Slot;
+
+        std::vector<void *>         m_apvBlocks;    /**< The blocks, each holding XANK_ATOM_ARENA_BLOCK_ATOMS slots. */
+        size_t                      m_idxBlock;     /**< Index of the block being allocated from. */
+        size_t                      m_cUsed;        /**< Number of slots allocated from the current block. */
+        Slot                       *m_pOwners;      /**< Slots of the Atoms to destruct on Reset(), last registered first. */
+};
+
+#endif /* XANK_ATOM_ARENA_H */
+
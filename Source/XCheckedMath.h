@@ -0,0 +1,53 @@
+/** @file
+ * xank - Overflow checked native arithmetic.
+ */
+
+/*
+ * Copyright (C) 2012 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XANK_CHECKED_MATH_H
+# define XANK_CHECKED_MATH_H
+
+#include <stdint.h>
+
+#if defined(__GNUC__) && (__GNUC__ >= 5 || defined(__clang__))
+# define XANK_HAVE_BUILTIN_OVERFLOW
+#endif
+
+/**
+ * Adds two signed 64-bit integers checking for overflow.
+ *
+ * @param iLeft         The first operand.
+ * @param iRight        The second operand.
+ * @param piResult      Where to store the result, undefined on overflow.
+ *
+ * @return bool: true if the result overflowed, false otherwise.
+ */
+static inline bool CheckedAddS64(int64_t iLeft, int64_t iRight, int64_t *piResult)
+{
+#ifdef XANK_HAVE_BUILTIN_OVERFLOW
+    return __builtin_add_overflow(iLeft, iRight, piResult);
+#else
+    /* Wrap in unsigned arithmetic, it overflowed if both operands have a sign that differs from the result. */
+    const uint64_t uResult = (uint64_t)iLeft + (uint64_t)iRight;
+    *piResult = (int64_t)uResult;
+    return ((((uint64_t)iLeft ^ uResult) & ((uint64_t)iRight ^ uResult)) >> 63) != 0;
+#endif
+}
+
+#endif /* XANK_CHECKED_MATH_H */
+
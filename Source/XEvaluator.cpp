@@ -25,11 +25,15 @@
 #include "XAtom.h"
 #include "XFunction.h"
 #include "XGenericDefs.h"
+#include "XJit.h"
 #include "XOperator.h"
+#include "XProgram.h"
 #include "XErrors.h"
 #include "ConsoleIO.h"
 #include "Debug.h"
 
+#include <cfloat>
+#include <cmath>
 #include <cstring>
 #include <cstdarg>
 #include <stdint.h>
@@ -37,6 +41,11 @@
 
 #include "XEvaluatorFunctions.cpp.h"
 
+#if defined(__GNUC__) || defined(__clang__)
+/** Labels as values, for a direct-threaded Evaluate(). */
+# define XANK_HAVE_COMPUTED_GOTO
+#endif
+
 XEvaluator::XEvaluator()
 {
     /** @todo add parameters to accept settings */
@@ -44,44 +53,19 @@ XEvaluator::XEvaluator()
     m_Error                    = ERR_NOT_INITIALIZED;
     m_sError                   = "Evaluator not initialized.";
     m_pOpenParenthesisOperator = NULL;
+    m_pProgram                 = NULL;
 }
 
 
 XEvaluator::~XEvaluator()
 {
-    while (!m_RPNQueue.empty())
-    {
-        XAtom *pAtom = m_RPNQueue.front();
-        m_RPNQueue.pop();
-        Assert(pAtom);
-        delete pAtom;
-        pAtom = NULL;
-    }
+    delete m_pProgram;
+    m_pProgram = NULL;
 }
 
 
-void XEvaluator::CleanUp(std::stack<XAtom*> *pStack, std::queue<XAtom*> *pQueue, int rc, const char *pcszMsg, ...)
+void XEvaluator::CleanUp(int rc, const char *pcszMsg, ...)
 {
-    if (pStack)
-        while (!pStack->empty())
-        {
-            XAtom *pAtom = pStack->top();
-            pStack->pop();
-            Assert(pAtom);
-            delete pAtom;
-            pAtom = NULL;
-        }
-
-    if (pQueue)
-        while (!pQueue->empty())
-        {
-            XAtom *pAtom = pQueue->front();
-            pQueue->pop();
-            Assert(pAtom);
-            delete pAtom;
-            pAtom = NULL;
-        }
-
     va_list FmtArgs;
     char szBuf[2048];
 
@@ -98,22 +82,6 @@ void XEvaluator::CleanUp(std::stack<XAtom*> *pStack, std::queue<XAtom*> *pQueue,
 }
 
 
-static int OperatorCompare(const void *pcvOperator1, const void *pcvOperator2)
-{
-    const XOperator *pcOperator1 = reinterpret_cast<const XOperator*>(pcvOperator1);
-    const XOperator *pcOperator2 = reinterpret_cast<const XOperator*>(pcvOperator2);
-    const char *pcszOperator1    = pcOperator1->Name().c_str();
-    const char *pcszOperator2    = pcOperator2->Name().c_str();
-    const size_t cbOperator1     = pcOperator1->Name().length();
-    const size_t cbOperator2     = pcOperator2->Name().length();
-
-    int rc = std::strncmp(pcszOperator1, pcszOperator2, XANK_MAX(cbOperator1, cbOperator2));
-    if (!rc)
-        return pcOperator2->Params() - pcOperator1->Params();
-    return -rc;
-}
-
-
 int XEvaluator::Init()
 {
     int rc = ERR_UNDEFINED;
@@ -125,7 +93,7 @@ int XEvaluator::Init()
             || pcOperator->LongDesc().empty())
         {
             rc = ERR_INVALID_OPERATOR;
-            CleanUp(NULL, NULL, rc,
+            CleanUp(rc,
                 "Operator with missing name, syntax or description. Index=%" FMT_SZT " Operator %s",
                 i, pcOperator->PrintToString().c_str());
             return rc;
@@ -134,7 +102,7 @@ int XEvaluator::Init()
         if (isdigit(*pcOperator->Name().c_str()) || pcOperator->Name() == ".")
         {
             rc = ERR_INVALID_OPERATOR;
-            CleanUp(NULL, NULL, rc,
+            CleanUp(rc,
                 "Invalid operator name. Index=%" FMT_U64 " Operator %s", i, pcOperator->PrintToString().c_str());
             return rc;
         }
@@ -147,7 +115,7 @@ int XEvaluator::Init()
         if (pcOperator->Params() > 2)
         {
             rc = ERR_INVALID_OPERATOR;
-            CleanUp(NULL, NULL, rc,
+            CleanUp(rc,
                 "Too many parameters. Index=%" FMT_SZT " Operator %s", i, pcOperator->PrintToString().c_str());
             return rc;
         }
@@ -165,7 +133,7 @@ int XEvaluator::Init()
             if (pcOperator->Id() == pcCur->Id())
             {
                 rc = ERR_CONFLICTING_OPERATORS;
-                CleanUp(NULL, NULL, rc,
+                CleanUp(rc,
                         "Duplicate operator Id=%" FMT_U32 " %s at [%" FMT_SZT "] and %s at [%" FMT_SZT "]",
                         pcOperator->Id(), pcOperator->PrintToString().c_str(), i, pcCur->PrintToString().c_str(), k);
                 return rc;
@@ -177,14 +145,14 @@ int XEvaluator::Init()
                 if (pcOperator->Params() == pcCur->Params())
                 {
                     rc = ERR_DUPLICATE_OPERATOR;
-                    CleanUp(NULL, NULL, rc,
+                    CleanUp(rc,
                         "Duplicate operator %s at [%" FMT_SZT "] and [%" FMT_SZT "]", pcOperator->PrintToString().c_str(),
                             i, k);
                     return rc;
                 }
 
                 rc = ERR_CONFLICTING_OPERATORS;
-                CleanUp(NULL, NULL, rc, "Conflicting operator %s at [%" FMT_SZT "] and [%" FMT_SZT "]",
+                CleanUp(rc, "Conflicting operator %s at [%" FMT_SZT "] and [%" FMT_SZT "]",
                         pcOperator->PrintToString().c_str(), i, k);
                 return rc;
             }
@@ -192,11 +160,16 @@ int XEvaluator::Init()
     }
 
     /*
-     * Sort operator list to workaround overlapping operator names, e.g.: "++" always appears before "+".
-     * While sorting operators with the same name, the one with more parameters is sorted first.
-     * For e.g. binary '-' is placed before unary '-', See ParseOperator().
+     * Build the operator trie to handle overlapping operator names, e.g.: "++" is matched before "+".
+     * Among operators with the same name, the one with more parameters is preferred.
+     * For e.g. binary '-' is tried before unary '-', See ParseOperator().
      */
-    std::qsort((void*)m_sOperators, m_cOperators, sizeof(XOperator), OperatorCompare);
+    rc = m_OperatorTrie.Build(m_sOperators, m_cOperators);
+    if (IS_FAILURE(rc))
+    {
+        CleanUp(rc, "Invalid operator name length, maximum is %d bytes.\n", XANK_MAX_OPERATOR_NAME_LEN);
+        return rc;
+    }
 
     const XOperator *pCloseParenthesisOperator = NULL;
     const XOperator *pParamSeparatorOperator   = NULL;
@@ -211,7 +184,7 @@ int XEvaluator::Init()
             else
             {
                 rc = ERR_DUPLICATE_OPERATOR;
-                CleanUp(NULL, NULL, rc, "Invalid duplicate operator: Open parenthesis\n");
+                CleanUp(rc, "Invalid duplicate operator: Open parenthesis\n");
                 return rc;
             }
         }
@@ -222,7 +195,7 @@ int XEvaluator::Init()
             else
             {
                 rc = ERR_DUPLICATE_OPERATOR;
-                CleanUp(NULL, NULL, rc, "Invalid duplicate operator: Close parenthesis\n");
+                CleanUp(rc, "Invalid duplicate operator: Close parenthesis\n");
                 return rc;
             }
         }
@@ -233,7 +206,7 @@ int XEvaluator::Init()
             else
             {
                 rc = ERR_DUPLICATE_OPERATOR;
-                CleanUp(NULL, NULL, rc, "Invalid duplicate operator: Parameter sepatator.\n");
+                CleanUp(rc, "Invalid duplicate operator: Parameter sepatator.\n");
                 return rc;
             }
         }
@@ -244,10 +217,32 @@ int XEvaluator::Init()
         || !pCloseParenthesisOperator)
     {
         rc = ERR_MISSING_BASIC_OPERATOR;
-        CleanUp(NULL, NULL, rc, "Basic operator missing.\n");
+        CleanUp(rc, "Basic operator missing.\n");
         return rc;
     }
 
+    /*
+     * Intern the function names, see ParseFunction().
+     */
+    m_FunctionTable.Clear();
+    for (size_t i = 0; i < m_cFunctions; i++)
+    {
+        const std::string &scName = m_sFunctions[i].Name();
+        if (XSymbolTable::IdentifierLength(scName.c_str()) != scName.length())
+        {
+            rc = ERR_INVALID_FUNCTOR;
+            CleanUp(rc, "Invalid function name '%s' at [%" FMT_SZT "].\n", scName.c_str(), i);
+            return rc;
+        }
+
+        rc = m_FunctionTable.Insert(scName.c_str(), scName.length(), (uint32_t)i);
+        if (IS_FAILURE(rc))
+        {
+            CleanUp(rc, "Duplicate function '%s' at [%" FMT_SZT "].\n", scName.c_str(), i);
+            return rc;
+        }
+    }
+
     m_fInitialized = true;
     return INF_SUCCESS;
 }
@@ -255,36 +250,139 @@ int XEvaluator::Init()
 
 int XEvaluator::Parse(const char *pcszExpr)
 {
-    DEBUGPRINTF(("--- Parse ---\n"));
+    XProgram *pProgram = NULL;
+    int rc = Parse(pcszExpr, &pProgram);
+    if (IS_SUCCESS(rc))
+    {
+        /*
+         * Replace the old program if any.
+         */
+        delete m_pProgram;
+        m_pProgram = pProgram;
+    }
+    return rc;
+}
+
+
+int XEvaluator::Parse(const char *pcszExpr, XProgram **ppProgram)
+{
+    return ParseBatch(&pcszExpr, 1, ppProgram);
+}
+
+
+int XEvaluator::Parse(const char *pcszExpr, uint32_t cFloatDigits, XProgram **ppProgram)
+{
+    return ParseBatch(&pcszExpr, 1, cFloatDigits, ppProgram);
+}
+
+
+int XEvaluator::ParseBatch(const char * const *papcszExprs, size_t cExprs, XProgram **ppProgram)
+{
+    uint32_t cFloatDigits;
+    m_Setttings.GetUInt32Def(XANK_SETTING_FLOAT_DIGITS, &cFloatDigits, 0);
+    return ParseBatch(papcszExprs, cExprs, cFloatDigits, ppProgram);
+}
+
+
+int XEvaluator::ParseBatch(const char * const *papcszExprs, size_t cExprs, uint32_t cFloatDigits,
+                           XProgram **ppProgram)
+{
+    DEBUGPRINTF(("--- ParseBatch ---\n"));
 
     if (!m_fInitialized)
         return ERR_NOT_INITIALIZED;
 
-    std::queue<XAtom*> Queue;
-    std::stack<XAtom*> Stack;
+    AssertReturn(papcszExprs, ERR_INVALID_PARAMETER);
+    AssertReturn(cExprs > 0, ERR_INVALID_PARAMETER);
+    AssertReturn(ppProgram, ERR_INVALID_PARAMETER);
+    if (cFloatDigits > XANK_MAX_FLOAT_DIGITS)
+    {
+        CleanUp(ERR_INVALID_PARAMETER, "Invalid float precision %u digits.\n", cFloatDigits);
+        return ERR_INVALID_PARAMETER;
+    }
+
+    XProgram *pProgram = new(std::nothrow) XProgram;
+    if (!pProgram)
+    {
+        CleanUp(ERR_NO_MEMORY, "No memory to allocate program.\n");
+        return ERR_NO_MEMORY;
+    }
+
+    /* The integer width is fixed when compiling, the constants are converted to it. */
+    std::string sWidth;
+    bool fSaturate;
+    m_Setttings.GetStringDef(XANK_SETTING_INTEGER_WIDTH, &sWidth, "");
+    m_Setttings.GetBoolDef(XANK_SETTING_INTEGER_SATURATION, &fSaturate, false);
+    int rc = pProgram->m_FixedWidth.SetFromName(sWidth, fSaturate);
+    if (IS_FAILURE(rc))
+    {
+        delete pProgram;
+        CleanUp(rc, "Invalid integer width.\n");
+        return rc;
+    }
+
+    /* Likewise the precision of float results, see PlanPrecisions(). */
+    pProgram->m_cFloatDigits = cFloatDigits;
+    if (cFloatDigits)
+        pProgram->m_cFloatBits = (mp_bitcnt_t)(((uint64_t)cFloatDigits * 3322 + 999) / 1000 + 1);   /* log2(10) < 3.322 */
+
+    /*
+     * Compile the expressions one after the other into the same Program, each leaving its
+     * result on the operand stack. The Atoms are only needed until an expression is compiled
+     * or fails to parse, release them all at once. Compiling hands the numbers over to the
+     * constant pool, so then no Atom is left holding GMP memory.
+     */
+    for (size_t i = 0; i < cExprs && IS_SUCCESS(rc); i++)
+    {
+        rc = ParseExpression(papcszExprs[i], pProgram);
+        if (IS_SUCCESS(rc))
+            m_AtomArena.ResetHandedOver();
+        else
+            m_AtomArena.Reset();
+    }
+
+    /*
+     * Optimizing the batch as a whole shares subexpressions across the expressions.
+     */
+    if (IS_SUCCESS(rc))
+        rc = Optimize(pProgram);
+
+    if (IS_FAILURE(rc))
+    {
+        delete pProgram;
+        return rc;
+    }
+
+    *ppProgram = pProgram;
+    return INF_SUCCESS;
+}
+
+
+int XEvaluator::ParseExpression(const char *pcszExpr, XProgram *pProgram)
+{
+    /* The operator stack and the RPN output are reused across parses, they never shrink. */
+    std::vector<XAtom*> &Queue = m_ParseQueue;
+    std::vector<XAtom*> &Stack = m_ParseStack;
+    Queue.clear();
+    Stack.clear();
     const char *pcszEnd  = NULL;
     XAtom *pAtom         = NULL;
     XAtom *pPreviousAtom = NULL;
     int rc               = ERR_UNDEFINED;
-    while ((pAtom = ParseAtom(pcszExpr, &pcszEnd, pPreviousAtom)) != NULL)
-    {
-        if (   pPreviousAtom
-            && pPreviousAtom->Operator()
-            && pPreviousAtom->Operator()->IsCloseParenthesis())
-        {
-            delete pPreviousAtom;
-            pPreviousAtom = NULL;
-        }
 
+    /* Literals are read with guard bits, the operations combining them lose a few. */
+    const mp_bitcnt_t cLiteralBits = pProgram->m_cFloatBits ? pProgram->m_cFloatBits + XANK_FLOAT_GUARD_BITS : 0;
+    while ((pAtom = ParseAtom(pcszExpr, &pcszEnd, pPreviousAtom, cLiteralBits)) != NULL)
+    {
         if (pAtom->IsNumber())
         {
             DEBUGPRINTF(("Queue push number %s\n", pAtom->PrintToString().c_str()));
-            Queue.push(pAtom);
+            Queue.push_back(pAtom);
         }
         else if (pAtom->Function())
         {
             DEBUGPRINTF(("Queue push function %s\n", pAtom->Function()->PrintToString().c_str()));
-            Stack.push(pAtom);
+            Stack.push_back(pAtom);
         }
         else if (pAtom->IsVariable())
         {
@@ -300,7 +398,7 @@ int XEvaluator::Parse(const char *pcszExpr)
             if (pcOperator->IsOpenParenthesis())
             {
                 DEBUGPRINTF(("Stack push parenthesis begin '%s'.\n", pcOperator->Name().c_str()));
-                Stack.push(pAtom);
+                Stack.push_back(pAtom);
             }
             else if (pcOperator->IsCloseParenthesis())
             {
@@ -308,64 +406,54 @@ int XEvaluator::Parse(const char *pcszExpr)
                 XAtom *pStackAtom = NULL;
                 while (!Stack.empty())
                 {
-                    pStackAtom = Stack.top();
+                    pStackAtom = Stack.back();
                     Assert(pStackAtom);
                     if (   pStackAtom->Operator()
                         && pStackAtom->Operator()->IsOpenParenthesis())
                         break;
                     DEBUGPRINTF(("Popping '%s' to queue.\n", pStackAtom->PrintToString().c_str()));
-                    Stack.pop();
-                    Queue.push(pStackAtom);
+                    Stack.pop_back();
+                    Queue.push_back(pStackAtom);
                 }
 
                 if (!pStackAtom)
                 {
                     DEBUGPRINTF(("Missing open parenthesis.\n"));
-                    delete pAtom;
-                    pAtom = NULL;
                     rc = ERR_UNBALANCED_PARENTHESIS;
-                    CleanUp(&Stack, &Queue, rc, "Missing open parenthesis.");
+                    CleanUp(rc, "Missing open parenthesis.");
                     return rc;
                 }
 
                 if (   pStackAtom->Operator()
                     && pStackAtom->Operator()->IsOpenParenthesis())
-                {
-                    Stack.pop();
-                    delete pStackAtom;
-                    pStackAtom = NULL;
-                }
+                    Stack.pop_back();
 
                 /*
                  * If the left parenthesis is preceeded by a function, pop it to the Queue
                  * incrementing number of parameters the function already has.
                  */
                 if (   !Stack.empty()
-                    && (pStackAtom = Stack.top()) != NULL
+                    && (pStackAtom = Stack.back()) != NULL
                     && (pStackAtom->Function()))
                 {
                     DEBUGPRINTF(("Popping Function '%s' to queue.\n", pStackAtom->Function()->Name().c_str()));
-                    Stack.pop();
-                    Queue.push(pStackAtom);
+                    Stack.pop_back();
+                    Queue.push_back(pStackAtom);
 
                     pStackAtom->IncrementFunctionParams();
                     if (pStackAtom->FunctionParams() > pStackAtom->Function()->MaxParams())
                     {
                         DEBUGPRINTF(("Too many params to Function '%s'.\n", pStackAtom->Function()->Name().c_str()));
-                        delete pAtom;
-                        pAtom = NULL;
                         rc = ERR_TOO_MANY_PARAMETERS;
-                        CleanUp(&Stack, &Queue, rc,
+                        CleanUp(rc,
                             "Too many parameters to function %s", pStackAtom->Function()->PrintToString().c_str());
                         return rc;
                     }
                     else if (pStackAtom->FunctionParams() < pStackAtom->Function()->MinParams())
                     {
                         DEBUGPRINTF(("Too few params to Function '%s'.\n", pStackAtom->Function()->Name().c_str()));
-                        delete pAtom;
-                        pAtom = NULL;
                         rc = ERR_TOO_FEW_PARAMETERS;
-                        CleanUp(&Stack, &Queue, rc,
+                        CleanUp(rc,
                             "Too few parameters to function %s", pStackAtom->Function()->PrintToString().c_str());
                         return rc;
                     }
@@ -379,7 +467,7 @@ int XEvaluator::Parse(const char *pcszExpr)
                 DEBUGPRINTF(("Function param separator.\n"));
                 XAtom *pStackAtom = NULL;
                 while (   !Stack.empty()
-                       && (pStackAtom = Stack.top()) != NULL)
+                       && (pStackAtom = Stack.back()) != NULL)
                 {
                     if (   pStackAtom->Operator()
                         && pStackAtom->Operator()->IsOpenParenthesis())
@@ -387,8 +475,8 @@ int XEvaluator::Parse(const char *pcszExpr)
                         break;
                     }
 
-                    Stack.pop();
-                    Queue.push(pStackAtom);
+                    Stack.pop_back();
+                    Queue.push_back(pStackAtom);
                 }
 
                 if (  !pStackAtom
@@ -396,21 +484,19 @@ int XEvaluator::Parse(const char *pcszExpr)
                         && pStackAtom->Operator()->IsOpenParenthesis()))
                 {
                     DEBUGPRINTF(("Operator '%s' param mismatch.\n", pcOperator->Name().c_str()));
-                    delete pAtom;
-                    pAtom = NULL;
                     rc = ERR_UNEXPECTED_PARENTHESIS_SEPARATOR;
-                    CleanUp(&Stack, &Queue, rc, "Operator %s parameter mismatch.\n", pcOperator->PrintToString().c_str());
+                    CleanUp(rc, "Operator %s parameter mismatch.\n", pcOperator->PrintToString().c_str());
                     return rc;
                 }
 
-                Stack.pop();
+                Stack.pop_back();
                 XAtom *pOpenParenAtom = pStackAtom;
                 pStackAtom            = NULL;
                 XAtom *pFunctionAtom  = NULL;
                 if (!Stack.empty())
                 {
-                    pFunctionAtom = Stack.top();
-                    Stack.pop();
+                    pFunctionAtom = Stack.back();
+                    Stack.pop_back();
                 }
 
                 if (   pFunctionAtom
@@ -421,10 +507,8 @@ int XEvaluator::Parse(const char *pcszExpr)
                     {
                         DEBUGPRINTF(("Too many params to Function '%s' max=%" FMT_U64 ".\n", pFunctionAtom->Function()->Name().c_str(),
                                 pFunctionAtom->Function()->MaxParams()));
-                        delete pAtom;
-                        pAtom = NULL;
                         rc = ERR_TOO_FEW_PARAMETERS;
-                        CleanUp(&Stack, &Queue, rc, "Too many parameters to Function %s", pFunctionAtom->Function()->PrintToString().c_str());
+                        CleanUp(rc, "Too many parameters to Function %s", pFunctionAtom->Function()->PrintToString().c_str());
                         return rc;
                     }
 
@@ -432,8 +516,8 @@ int XEvaluator::Parse(const char *pcszExpr)
                      * Now that we've recorded the information into the Function Atom, restore the
                      * stack items as though nothing happened :)
                      */
-                    Stack.push(pFunctionAtom);
-                    Stack.push(pOpenParenAtom);
+                    Stack.push_back(pFunctionAtom);
+                    Stack.push_back(pOpenParenAtom);
 
                     DEBUGPRINTF(("Function '%s' cParams=%" FMT_U64 ".\n", pFunctionAtom->Function()->Name().c_str(),
                             pFunctionAtom->FunctionParams()));
@@ -441,10 +525,8 @@ int XEvaluator::Parse(const char *pcszExpr)
                 else
                 {
                     DEBUGPRINTF(("No function specified.\n"));
-                    delete pAtom;
-                    pAtom = NULL;
                     rc = ERR_UNEXPECTED_PARENTHESIS_SEPARATOR;
-                    CleanUp(&Stack, &Queue, rc, "No function specified.\n");
+                    CleanUp(rc, "No function specified.\n");
                     return rc;
                 }
             }
@@ -461,7 +543,7 @@ int XEvaluator::Parse(const char *pcszExpr)
                  */
                 XAtom *pStackAtom = NULL;
                 while (   !Stack.empty()
-                        && (pStackAtom = Stack.top()) != NULL)
+                        && (pStackAtom = Stack.back()) != NULL)
                 {
                     const XOperator *pcStackOperator = pStackAtom->Operator();
                     if (  !pcStackOperator
@@ -475,8 +557,8 @@ int XEvaluator::Parse(const char *pcszExpr)
                     {
                         DEBUGPRINTF(("Moving operator '%s' cParams=%" FMT_U8 " from stack to queue.\n",
                                 pcStackOperator->Name().c_str(), pcStackOperator->Params()));
-                        Stack.pop();
-                        Queue.push(pStackAtom);
+                        Stack.pop_back();
+                        Queue.push_back(pStackAtom);
                     }
                     else
                         break;
@@ -484,14 +566,12 @@ int XEvaluator::Parse(const char *pcszExpr)
 
                 DEBUGPRINTF(("Pushing operator '%s' (id=%" FMT_U32 ") cParams=%" FMT_U8 " to stack.\n",
                         pcOperator->Name().c_str(), pcOperator->Id(), pcOperator->Params()));
-                Stack.push(pAtom);
+                Stack.push_back(pAtom);
             }
         }
         else
         {
             DEBUGPRINTF(("Unknown token.\n"));
-            delete pAtom;
-            pAtom = NULL;
             break;
         }
         pcszExpr = pcszEnd;
@@ -504,15 +584,12 @@ int XEvaluator::Parse(const char *pcszExpr)
      */
     pAtom = NULL;
     if (   !Stack.empty()
-        && (pAtom = Stack.top()) != NULL
+        && (pAtom = Stack.back()) != NULL
         && pAtom->Operator()
         && pAtom->Operator()->IsOpenParenthesis())
     {
         rc = ERR_UNBALANCED_PARENTHESIS;
-        Stack.pop();
-        delete pAtom;
-        pAtom = NULL;
-        CleanUp(&Stack, &Queue, rc, "Unbalanced parenthesis.\n");
+        CleanUp(rc, "Unbalanced parenthesis.\n");
         return rc;
     }
 
@@ -520,245 +597,575 @@ int XEvaluator::Parse(const char *pcszExpr)
      * Pop the remaining Operators, Functions to the queue.
      */
     while (   !Stack.empty()
-           && (pAtom = Stack.top()) != NULL)
+           && (pAtom = Stack.back()) != NULL)
     {
-        Stack.pop();
-        Queue.push(pAtom);
+        Stack.pop_back();
+        Queue.push_back(pAtom);
     }
 
     if (Queue.empty())
     {
         rc = ERR_INVALID_EXPRESSION;
-        CleanUp(&Stack, &Queue, rc, "No atoms detected.\n");
+        CleanUp(rc, "No atoms detected.\n");
         return rc;
     }
 
-    /*
-     * Clear old queue if any, and restore the new one.
-     */
-    while (  !m_RPNQueue.empty()
-           && (pAtom = m_RPNQueue.front()) != NULL)
+    DumpAtomQueue(Queue);
+    rc = Compile(Queue, pProgram);
+    if (IS_FAILURE(rc))
     {
-        m_RPNQueue.pop();
-        delete pAtom;
-        pAtom = NULL;
+        CleanUp(rc, "Failed to compile expression.\n");
+        return rc;
     }
 
-    m_RPNQueue = Queue;
-    DumpAtomQueue(&Queue);
-    CleanUp(NULL, NULL, INF_SUCCESS, "Expression parsed successfully.");
+    CleanUp(INF_SUCCESS, "Expression parsed successfully.");
     return INF_SUCCESS;
 }
 
 
-int XEvaluator::Evaluate()
+int XEvaluator::Optimize(XProgram *pProgram)
 {
-    DEBUGPRINTF(("--- Evaluate ---\n"));
+    /*
+     * Plan the float precisions once, on the Instructions as compiled, so they are the same
+     * whichever passes run. The passes keep the plan: folding and typing promote and compute
+     * with the planned precisions, and only share or fuse Instructions planned alike.
+     */
+    int rc = INF_SUCCESS;
+    if (pProgram->m_cFloatBits)
+    {
+        rc = PlanPrecisions(pProgram);
+        if (IS_FAILURE(rc))
+        {
+            CleanUp(rc, "Failed to plan float precisions.\n");
+            return rc;
+        }
+    }
 
-    if (!m_fInitialized)
-        return ERR_NOT_INITIALIZED;
+    if (pProgram->m_FixedWidth.IsFixed())
+    {
+        rc = NarrowIntegers(pProgram);
+        if (IS_FAILURE(rc))
+        {
+            CleanUp(rc, "Expression not supported with fixed-width integers.\n");
+            return rc;
+        }
+    }
 
-    if (m_RPNQueue.empty())
-        return ERR_UNPARSED_EXPRESSION;
+    bool fFold;
+    m_Setttings.GetBoolDef(XANK_SETTING_CONSTANT_FOLDING, &fFold, true);
+    if (fFold)
+        rc = FoldConstants(pProgram);
+
+    bool fCse;
+    m_Setttings.GetBoolDef(XANK_SETTING_COMMON_SUBEXPRESSIONS, &fCse, true);
+    if (   IS_SUCCESS(rc)
+        && fCse)
+        rc = EliminateCommonSubexpressions(pProgram);
+
+    /* Typing last but for fusion, the passes before it work on untyped Instructions. */
+    bool fTypes;
+    m_Setttings.GetBoolDef(XANK_SETTING_TYPE_SPECIALIZATION, &fTypes, true);
+    if (   IS_SUCCESS(rc)
+        && fTypes)
+        rc = SpecializeTypes(pProgram);
+
+    bool fFuse;
+    m_Setttings.GetBoolDef(XANK_SETTING_OPERATOR_FUSION, &fFuse, true);
+    if (   IS_SUCCESS(rc)
+        && fFuse)
+        rc = FuseOperators(pProgram);
+
+    /* After the passes on the stack machine Instructions, lowering them is not an optimization. */
+    bool fRegisters;
+    m_Setttings.GetBoolDef(XANK_SETTING_REGISTER_MACHINE, &fRegisters, false);
+    if (   IS_SUCCESS(rc)
+        && fRegisters)
+        rc = AllocateRegisters(pProgram);
+
+    bool fSuper;
+    m_Setttings.GetBoolDef(XANK_SETTING_SUPERINSTRUCTIONS, &fSuper, true);
+    if (   IS_SUCCESS(rc)
+        && fSuper)
+        rc = FormSuperinstructions(pProgram);
+
+    if (IS_FAILURE(rc))
+    {
+        CleanUp(rc, "Failed to optimize expression.\n");
+        return rc;
+    }
 
-    std::stack<XAtom *> Stack;
-    XAtom *pAtom = NULL;
-    int rc       = ERR_NOT_INITIALIZED;
+    /* Likewise evaluating in doubles, the GMP floats are still used if they're not accurate enough. */
+    bool fDoubleTier;
+    m_Setttings.GetBoolDef(XANK_SETTING_DOUBLE_TIER, &fDoubleTier, false);
+    if (fDoubleTier)
+    {
+        uint32_t cDigits;
+        m_Setttings.GetUInt32Def(XANK_SETTING_DOUBLE_TIER_DIGITS, &cDigits, 15);
 
-    while ((pAtom = m_RPNQueue.front()) != NULL)
+        /* Not less accurate than the Program's floats. */
+        PrepareDoubleTier(pProgram, XANK_MAX(cDigits, pProgram->m_cFloatDigits));
+    }
+
+    /*
+     * Last, compile to native code from the final Instructions. Most Programs don't compute
+     * with machine words only, or the platform isn't supported, they are simply interpreted.
+     */
+    bool fNative;
+    m_Setttings.GetBoolDef(XANK_SETTING_NATIVE_CODE, &fNative, true);
+    if (   fNative
+        && XJit::IsSupported())
     {
-        m_RPNQueue.pop();
+        XJit *pJit = new(std::nothrow) XJit();
+        if (   pJit
+            && IS_SUCCESS(pJit->Compile(pProgram)))
+            pProgram->m_pJit = pJit;
+        else
+            delete pJit;
+    }
+
+    DEBUGPRINTF(("Program:\n%s", pProgram->PrintToString().c_str()));
+    return INF_SUCCESS;
+}
+
 
+int XEvaluator::Compile(const std::vector<XAtom*> &Queue, XProgram *pProgram)
+{
+    /*
+     * Every Atom becomes exactly one Instruction and at most one constant, size the arrays
+     * up-front so neither of them is reallocated while lowering.
+     */
+    pProgram->m_Instructions.reserve(pProgram->m_Instructions.size() + Queue.size());
+    pProgram->m_Constants.reserve(pProgram->m_Constants.size() + Queue.size());
+
+    /*
+     * Track the operand stack depth as we go, this validates the RPN so that Evaluate()
+     * needn't check operand counts, and gives the frame size Evaluate() needs.
+     */
+    size_t cDepth    = 0;
+    size_t cMaxDepth = 0;
+    int rc = INF_SUCCESS;
+    for (size_t i = 0; i < Queue.size(); i++)
+    {
+        XAtom *pAtom = Queue[i];
+        Assert(pAtom);
+
+        XInstruction Instr;
+        Instr.cFloatBits = 0;
         if (pAtom->IsNumber())
         {
-            DEBUGPRINTF(("Pushing %s to stack.\n", pAtom->PrintToString().c_str()));
-            Stack.push(pAtom);
+            Instr.enmOp         = enmInstructionOpPushConstant;
+            Instr.cParams       = 0;
+            Instr.u.idxConstant = pProgram->m_Constants.size();
+            pProgram->m_Constants.push_back(XAtom());
+            pProgram->m_Constants.back().Swap(*pAtom);    /* Hand the value over, no copy. */
+            ++cDepth;
         }
         else if (pAtom->Operator())
         {
             const XOperator *pcOperator = pAtom->Operator();
-            DEBUGPRINTF(("Operator %s\n", pcOperator->Name().c_str()));
-            if (Stack.size() < pcOperator->Params())
+            if (pcOperator->IsOpenParenthesis())
             {
-                DEBUGPRINTF(("Stack size=%" FMT_SZT " cParams=" FMT_U8 ".\n", Stack.size(), pcOperator->Params()));
-                rc = ERR_TOO_FEW_PARAMETERS;
-                CleanUp(&Stack, &m_RPNQueue, rc,
-                        "Insufficient parameters to operator %s cParams=%" FMT_U8 "\n", pcOperator->Name().c_str(),
-                        pcOperator->Params());
-                return rc;
+                rc = ERR_UNBALANCED_PARENTHESIS;
+                break;
             }
-
-            /*
-             * Construct the array of parameter Atoms and pass it to the Operator evaluator if any, otherwise just
-             * push the first parameter as the result.
-             */
-            XAtom *apAtoms[XANK_MAX_OPERATOR_PARAMETERS];
-            Assert(pcOperator->Params() < XANK_MAX_OPERATOR_PARAMETERS);
-            uint8_t cParams = pcOperator->Params();
-            while (cParams > 0)
+            if (   !pcOperator->Params()
+                || cDepth < pcOperator->Params())
             {
-                apAtoms[cParams - 1] = Stack.top();   /* We've already checked Stack.size() above, so this is fine. */
-                DEBUGPRINTF(("%s\n", apAtoms[cParams - 1]->PrintToString().c_str()));
-                Stack.pop();
-                --cParams;
-
-                /** @todo handle type-cast stuff here, i.e. operator specifies what range it
-                 *        can take and we fiddle with the Atom to figure out if it's valid or
-                 *        not. */
+                rc = ERR_TOO_FEW_PARAMETERS;
+                break;
             }
+            cDepth -= pcOperator->Params() - 1;
 
-            XAtom *pResultAtom = NULL;
-            if (pcOperator->Function())
+            Instr.enmOp        = enmInstructionOpOperator;
+            Instr.cParams      = pAtom->Operator()->Params();
+            Instr.u.pcOperator = pAtom->Operator();
+        }
+        else if (pAtom->Function())
+        {
+            if (pAtom->FunctionParams() > UINT32_MAX)
             {
-                DEBUGPRINTF(("Invoking %s cParams=%" FMT_U8 "\n", pcOperator->Name().c_str(), pcOperator->Params()));
-                rc = pcOperator->Invoke(apAtoms, pcOperator->Params(), NULL /* pvData */);
-                if (IS_SUCCESS(rc))
-                    pResultAtom = apAtoms[0];
+                rc = ERR_TOO_MANY_PARAMETERS;
+                break;
             }
-            else
+            if (cDepth < pAtom->FunctionParams())
             {
-                rc = INF_SUCCESS;
-                pResultAtom = apAtoms[0];
+                rc = ERR_TOO_FEW_PARAMETERS;
+                break;
             }
+            cDepth -= (size_t)pAtom->FunctionParams();
+            ++cDepth;
+
+            Instr.enmOp        = enmInstructionOpFunction;
+            Instr.cParams      = (uint32_t)pAtom->FunctionParams();
+            Instr.u.pcFunction = pAtom->Function();
+        }
+        else
+        {
+            /** @todo variables. */
+            rc = ERR_INVALID_RPN;
+            break;
+        }
+
+        pProgram->m_Instructions.push_back(Instr);
+        cMaxDepth = XANK_MAX(cMaxDepth, cDepth);
+    }
+
+    /*
+     * Exactly the result must be left on the stack, above the results of the expressions
+     * compiled before.
+     */
+    if (   IS_SUCCESS(rc)
+        && cDepth != 1)
+        rc = ERR_INVALID_EXPRESSION;
+
+    pProgram->m_cMaxDepth = XANK_MAX(pProgram->m_cMaxDepth, pProgram->m_cResults + cMaxDepth);
+    ++pProgram->m_cResults;
+    return rc;
+}
+
+
+Settings *XEvaluator::EvaluatorSettings()
+{
+    return &m_Setttings;
+}
+
+
+int XEvaluator::Evaluate()
+{
+    if (!m_fInitialized)
+        return ERR_NOT_INITIALIZED;
 
-            if (pResultAtom)
+    if (!m_pProgram)
+        return ERR_UNPARSED_EXPRESSION;
+
+    return Evaluate(m_pProgram, NULL /* pResult */);
+}
+
+
+/**
+ * Invokes an Operator function on the topmost operands of the frame, the result
+ * replaces the first operand. Without a function the first operand is the result.
+ */
+static inline int EvaluateOperator(PFNOPERATOR pfnOperator, const XInstruction *pcInstr, XAtom **papFrame,
+                                   size_t *pcStack, void *pvData)
+{
+    const size_t cParams = pcInstr->cParams;
+    Assert(cParams > 0 && cParams <= *pcStack);
+    DEBUGPRINTF(("Operator %s cParams=%" FMT_SZT "\n", pcInstr->u.pcOperator->Name().c_str(), cParams));
+
+    int rc = INF_SUCCESS;
+    if (pfnOperator)
+        rc = pfnOperator(&papFrame[*pcStack - cParams], cParams, pvData);
+    *pcStack -= cParams - 1;
+    return rc;
+}
+
+
+/**
+ * Returns the function of an Operator an Instruction invokes, and the pvData to pass it.
+ * Sets the precision the Operator promotes integers with.
+ */
+static inline PFNOPERATOR OperatorFunction(const XProgram *pcProgram, XInstructionOp enmOp, const XOperator *pcOperator,
+                                           uint32_t cFloatBits, XScratchPool *pPool, void **ppvData)
+{
+    pPool->SetFloatPrecision(cFloatBits);
+    *ppvData = pPool;
+    switch (enmOp)
+    {
+        case enmInstructionOpOperatorInteger:   return pcOperator->IntegerFunction();
+        case enmInstructionOpOperatorFloat:     return pcOperator->FloatFunction();
+        case enmInstructionOpOperatorFixed:
+            *ppvData = const_cast<XFixedWidth *>(&pcProgram->FixedWidth());    /* Only read. */
+            return pcOperator->FixedFunction();
+        default:                                return pcOperator->Function();
+    }
+}
+
+
+#ifdef XANK_HAVE_COMPUTED_GOTO
+/* Labels as values are an extension, which -pedantic warns about. */
+# pragma GCC diagnostic push
+# pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+int XEvaluator::Evaluate(const XProgram *pcProgram, XAtom *pResult)
+{
+    DEBUGPRINTF(("--- Evaluate ---\n"));
+
+    if (!m_fInitialized)
+        return ERR_NOT_INITIALIZED;
+
+    if (   !pcProgram
+        || !pcProgram->Size())
+        return ERR_UNPARSED_EXPRESSION;
+
+    /*
+     * Run native code if the Program has any. When one of its overflow guards fires the
+     * results need more than a machine word and the Program is interpreted instead.
+     */
+    if (pcProgram->m_pJit)
+    {
+        const size_t cResults = pcProgram->Results();
+        if (m_aiNativeResults.size() < cResults)
+            m_aiNativeResults.resize(cResults);
+        if (m_aiNativeTemps.size() < XANK_MAX(pcProgram->Temps(), (size_t)1))
+            m_aiNativeTemps.resize(XANK_MAX(pcProgram->Temps(), (size_t)1));
+
+        if (pcProgram->m_pJit->Run(&m_aiNativeResults[0], &m_aiNativeTemps[0]))
+        {
+            if (pResult)
             {
-                Assert(IS_SUCCESS(rc));
-                for (uint8_t i = 1 /* not zero, duh! */; i < pcOperator->Params(); i++)
+                for (size_t i = 0; i < cResults; i++)
                 {
-                    delete apAtoms[i];
-                    apAtoms[i] = NULL;
+                    pResult[i].SetSmallInteger(m_aiNativeResults[i]);
+                    pcProgram->m_FixedWidth.Widen(&pResult[i]);
                 }
-                Stack.push(apAtoms[0]);
-            }
-            else
-            {
-                Assert(IS_FAILURE(rc));
-                DEBUGPRINTF(("Operator %s failed on given operands. rc=%d\n", pcOperator->Name().c_str(), rc));
-                CleanUp(&Stack, &m_RPNQueue, rc,
-                        "Operator %s failed on given operands.", pcOperator->Name().c_str());
-                return rc;
             }
+            CleanUp(INF_SUCCESS, "Expression evaluated successfully.\n");
+            return INF_SUCCESS;
         }
-        else if (pAtom->Function())
+        DEBUGPRINTF(("Native code overflowed, interpreting.\n"));
+    }
+
+    if (   pcProgram->m_fDoubleTier
+        && EvaluateDoubles(pcProgram, pResult))
+    {
+        CleanUp(INF_SUCCESS, "Expression evaluated successfully.\n");
+        return INF_SUCCESS;
+    }
+
+    if (pcProgram->m_fRegisters)
+        return EvaluateRegisters(pcProgram, pResult);
+
+    /*
+     * The Program was validated when compiled and knows how deep its operand stack gets,
+     * make sure the frame is at least that large. The frame holds the operand stack by value
+     * and is kept across evaluations, so its Atoms keep their GMP limbs. The pointer frame
+     * lets Operators and Functions take their operands as a slice of it.
+     */
+    const size_t cMaxDepth = pcProgram->MaxStackDepth();
+    if (m_Frame.size() < cMaxDepth)
+    {
+        m_Frame.resize(cMaxDepth);
+        m_apFrame.resize(cMaxDepth);
+        for (size_t i = 0; i < cMaxDepth; i++)
+            m_apFrame[i] = &m_Frame[i];
+    }
+
+    /* Likewise for the temporaries holding common subexpressions. */
+    if (m_Temps.size() < pcProgram->Temps())
+        m_Temps.resize(pcProgram->Temps());
+
+    XAtom **papFrame = &m_apFrame[0];
+    size_t cStack    = 0;
+    int rc           = INF_SUCCESS;
+
+    const XInstruction *pcInstr    = pcProgram->Instructions();
+    const XInstruction *pcInstrEnd = pcInstr + pcProgram->Size();
+
+#ifdef XANK_HAVE_COMPUTED_GOTO
+    /*
+     * Direct threading: each handler jumps straight to the handler of the next Instruction
+     * instead of going back to a single dispatch point, which gives the branch predictor one
+     * indirect jump per handler to learn. Indexed by XInstructionOp.
+     */
+    static void * const s_apvHandlers[] =
+    {
+        &&l_PushConstant,
+        &&l_Operator,
+        &&l_Function,
+        &&l_Store,
+        &&l_Load,
+        &&l_OperatorInteger,
+        &&l_OperatorFloat,
+        &&l_OperatorFixed,
+        &&l_ToFloat,
+        &&l_PushConstantOperator
+    };
+# define XANK_HANDLER(a_Op)     l_##a_Op
+# define XANK_DISPATCH() \
+    do { \
+        if (pcInstr == pcInstrEnd) \
+            goto l_Done; \
+        Assert(   cStack <= cMaxDepth \
+               && (size_t)(pcInstr->enmOp - enmInstructionOpPushConstant) < XANK_ARRAY_ELEMENTS(s_apvHandlers)); \
+        goto *s_apvHandlers[pcInstr->enmOp - enmInstructionOpPushConstant]; \
+    } while (0)
+# define XANK_NEXT()            do { ++pcInstr; XANK_DISPATCH(); } while (0)
+
+    XANK_DISPATCH();
+#else
+# define XANK_HANDLER(a_Op)     case enmInstructionOp##a_Op
+# define XANK_NEXT()            { ++pcInstr; continue; }
+
+    while (pcInstr < pcInstrEnd)
+    {
+        Assert(cStack <= cMaxDepth);
+        switch (pcInstr->enmOp)
         {
-            const XFunction *pcFunction = pAtom->Function();
-            DEBUGPRINTF(("%s ", pcFunction->Name().c_str()));
+#endif
+            XANK_HANDLER(PushConstant):
+            {
+                const XAtom *pcConstant = pcProgram->Constant(pcInstr->u.idxConstant);
+                DEBUGPRINTF(("Pushing %s to stack.\n", pcConstant->PrintToString().c_str()));
+                *papFrame[cStack++] = *pcConstant;
+                XANK_NEXT();
+            }
 
-            if (Stack.size() < pAtom->FunctionParams())
+            XANK_HANDLER(Operator):
             {
-                DEBUGPRINTF(("Stack size=%" FMT_SZT " cParams=%" FMT_U8 "\n", Stack.size(), pAtom->FunctionParams()));
-                rc = ERR_TOO_FEW_PARAMETERS;
-                CleanUp(&Stack, &m_RPNQueue, rc,
-                        "Insufficient parameters to function %s cParams=%" FMT_U8 "\n", pcFunction->Name().c_str(),
-                        pAtom->FunctionParams());
-                return rc;
+                m_ScratchPool.SetFloatPrecision(pcInstr->cFloatBits);
+                rc = EvaluateOperator(pcInstr->u.pcOperator->Function(), pcInstr, papFrame, &cStack, &m_ScratchPool);
+                if (IS_FAILURE(rc))
+                    goto l_OperatorFailed;
+                XANK_NEXT();
             }
 
-            /*
-             * Construct an array of maximum possible XAtoms parameters and pass it to the function
-             * actuator if any, otherwise just push the first paramater as the result.
-             */
-            AssertCompile(XANK_MAX_FUNCTION_PARAMETERS == SIZE_MAX);
-            Assert(pcFunction->MaxParams() <= XANK_MAX_FUNCTION_PARAMETERS);
+            XANK_HANDLER(OperatorInteger):
+            {
+                rc = EvaluateOperator(pcInstr->u.pcOperator->IntegerFunction(), pcInstr, papFrame, &cStack, &m_ScratchPool);
+                if (IS_FAILURE(rc))
+                    goto l_OperatorFailed;
+                XANK_NEXT();
+            }
 
-            const size_t cParams = XANK_MIN(pAtom->FunctionParams(), XANK_MAX_FUNCTION_PARAMETERS);
-            XAtom **ppaAtoms     = new(std::nothrow) XAtom *[cParams];
-            if (!ppaAtoms)
+            XANK_HANDLER(OperatorFloat):
             {
-                rc = ERR_NO_MEMORY;
-                CleanUp(&Stack, &m_RPNQueue, rc,
-                        "No memory to allocate %" FMT_SZT " Atoms.\n", cParams);
-                return rc;
+                rc = EvaluateOperator(pcInstr->u.pcOperator->FloatFunction(), pcInstr, papFrame, &cStack, &m_ScratchPool);
+                if (IS_FAILURE(rc))
+                    goto l_OperatorFailed;
+                XANK_NEXT();
             }
 
-            rc = ERR_UNDEFINED;
-            size_t cParamsTmp = cParams;
-            while (cParamsTmp--)
+            XANK_HANDLER(OperatorFixed):
             {
-                ppaAtoms[cParamsTmp] = Stack.top();
-                Stack.pop();
+                rc = EvaluateOperator(pcInstr->u.pcOperator->FixedFunction(), pcInstr, papFrame, &cStack,
+                                      const_cast<XFixedWidth *>(&pcProgram->m_FixedWidth));
+                if (IS_FAILURE(rc))
+                    goto l_OperatorFailed;
+                XANK_NEXT();
+            }
 
-                /** @todo check if the Function can cast to the required to perform its
-                 *        operation. If not, we cannot proceed as it would invoke undefined
-                 *        behaviour. */
+            XANK_HANDLER(PushConstantOperator):
+            {
+                /*
+                 * Superinstruction of a constant push and the Operator that follows it, which
+                 * the constant is a second or later operand of. Operators only read those,
+                 * so the constant is passed in place instead of being copied to the frame.
+                 */
+                const XAtom *pcConstant = pcProgram->Constant(pcInstr->u.idxConstant);
+                const size_t idxSlot    = cStack;
+                papFrame[cStack++]      = const_cast<XAtom *>(pcConstant);
+
+                ++pcInstr;
+                Assert(pcInstr < pcInstrEnd && pcInstr->cParams >= 2);
+                void *pvData;
+                PFNOPERATOR pfnOperator = OperatorFunction(pcProgram, pcInstr->enmOp, pcInstr->u.pcOperator, pcInstr->cFloatBits,
+                                                           &m_ScratchPool, &pvData);
+                rc = EvaluateOperator(pfnOperator, pcInstr, papFrame, &cStack, pvData);
+                papFrame[idxSlot] = &m_Frame[idxSlot];
+                if (IS_FAILURE(rc))
+                    goto l_OperatorFailed;
+                XANK_NEXT();
             }
 
-            XAtom *pResultAtom = NULL;
-            if (pcFunction->Function())
+            XANK_HANDLER(Function):
             {
-                rc = pcFunction->Invoke(ppaAtoms, cParams);
-                if (IS_SUCCESS(rc))
-                    pResultAtom = ppaAtoms[0];
+                /*
+                 * Same as Operators. A Function without parameters gets a fresh slot for its result.
+                 */
+                const XFunction *pcFunction = pcInstr->u.pcFunction;
+                const size_t cParams        = pcInstr->cParams;
+                Assert(cParams <= cStack);
+                DEBUGPRINTF(("Function %s cParams=%" FMT_SZT "\n", pcFunction->Name().c_str(), cParams));
+
+                if (!cParams)
+                    *papFrame[cStack++] = XAtom();
+
+                if (pcFunction->Function())
+                {
+                    XAtom **papAtoms = &papFrame[cStack - XANK_MAX(cParams, 1)];
+                    m_ScratchPool.SetFloatPrecision(pcInstr->cFloatBits);
+                    rc = pcFunction->Invoke(papAtoms, cParams, &m_ScratchPool);
+                    if (IS_FAILURE(rc))
+                        goto l_FunctionFailed;
+                }
+                if (cParams)
+                    cStack -= cParams - 1;
+                XANK_NEXT();
             }
-            else
+
+            XANK_HANDLER(Store):
             {
-                pResultAtom = ppaAtoms[0];
-                AssertReturn(pResultAtom, ERR_GENERAL_FAILURE);
-                rc = INF_SUCCESS;
+                Assert(cStack > 0 && pcInstr->u.idxTemp < m_Temps.size());
+                m_Temps[pcInstr->u.idxTemp] = *papFrame[cStack - 1];
+                XANK_NEXT();
             }
 
-            /* Cleanup temporaries and stack. */
-            for (size_t i = 1; i < cParams; i++)
+            XANK_HANDLER(Load):
             {
-                delete ppaAtoms[i];
-                ppaAtoms[i] = NULL;
+                Assert(pcInstr->u.idxTemp < m_Temps.size());
+                *papFrame[cStack++] = m_Temps[pcInstr->u.idxTemp];
+                XANK_NEXT();
             }
-            delete[] ppaAtoms;
-            ppaAtoms = NULL;
 
-            if (IS_SUCCESS(rc))
+            XANK_HANDLER(ToFloat):
             {
-                Assert(pResultAtom);
-                Stack.push(pResultAtom);
+                Assert(pcInstr->u.offStack < cStack);
+                papFrame[cStack - 1 - pcInstr->u.offStack]->MutableFloat(pcInstr->cFloatBits);
+                XANK_NEXT();
             }
-            else
+
+#ifdef XANK_HAVE_COMPUTED_GOTO
+l_Done:
+#else
+            default:
             {
-                DEBUGPRINTF(("Function %s failed with given operands. rc=%d\n", pcFunction->Name().c_str(), rc));
-                CleanUp(&Stack, &m_RPNQueue, rc,
-                        "Function %s failed with given operands.\n", pcFunction->Name().c_str());
+                DEBUGPRINTF(("Wow, an undiscovered Instruction!\n"));
+                rc = ERR_INVALID_RPN;
+                CleanUp(rc, "Invalid Instruction in program.\n");
                 return rc;
             }
         }
-        else if (pAtom->Variable())
-        {
-            /** @todo variable evaluation. */
-        }
-        else
-        {
-            DEBUGPRINTF(("Wow, an undiscovered Atom!\n"));
-            delete pAtom;
-            pAtom = NULL;
-        }
     }
+#endif
+#undef XANK_HANDLER
+#undef XANK_NEXT
+#undef XANK_DISPATCH
 
     /*
-     * Result is on the stack, otherwise it's an error.
+     * Compile() made sure exactly the results are left on the stack, in expression order.
      */
-    if (Stack.size() == 1)
+    Assert(cStack == pcProgram->Results());
+    DEBUGPRINTF(("Result is %s\n", papFrame[0]->PrintToString().c_str()));
+    if (pResult)
     {
-        pAtom = Stack.top();
-        Stack.pop();
-        DEBUGPRINTF(("Result is %s\n", pAtom->PrintToString().c_str()));
-        rc = INF_SUCCESS;
-        CleanUp(NULL, NULL, rc,
-                "Expression evaluated successfully.\n");
-
-        /** @todo do something with the result atom! Copy it to a string? or cast and
-         *        send it to the caller? Hmm think about this. */
-
-        delete pAtom;
-        pAtom = NULL;
-        return rc;
+        for (size_t i = 0; i < cStack; i++)
+        {
+            pResult[i] = *papFrame[i];
+            pcProgram->m_FixedWidth.Widen(&pResult[i]);
+        }
     }
 
-    rc = ERR_INVALID_EXPRESSION;
-    CleanUp(&Stack, &m_RPNQueue, rc,
-            "Excess atoms, invalid expression.\n");
+    rc = INF_SUCCESS;
+    CleanUp(rc, "Expression evaluated successfully.\n");
+    return rc;
+
+l_OperatorFailed:
+    DEBUGPRINTF(("Operator %s failed on given operands. rc=%d\n", pcInstr->u.pcOperator->Name().c_str(), rc));
+    CleanUp(rc, "Operator %s failed on given operands.", pcInstr->u.pcOperator->Name().c_str());
+    return rc;
+
+l_FunctionFailed:
+    DEBUGPRINTF(("Function %s failed with given operands. rc=%d\n", pcInstr->u.pcFunction->Name().c_str(), rc));
+    CleanUp(rc, "Function %s failed with given operands.\n", pcInstr->u.pcFunction->Name().c_str());
     return rc;
 }
+#ifdef XANK_HAVE_COMPUTED_GOTO
+# pragma GCC diagnostic pop
+#endif
 
-XAtom *XEvaluator::ParseAtom(const char *pcszExpr, const char **ppcszEnd, const XAtom *pcPreviousAtom)
+XAtom *XEvaluator::ParseAtom(const char *pcszExpr, const char **ppcszEnd, const XAtom *pcPreviousAtom,
+                             mp_bitcnt_t cLiteralBits)
 {
     DEBUGPRINTF(("ParseAtom \"%s\"\n", pcszExpr));
     XAtom *pAtom = NULL;
@@ -778,7 +1185,7 @@ XAtom *XEvaluator::ParseAtom(const char *pcszExpr, const char **ppcszEnd, const
         if (pAtom)
             break;
 
-        pAtom = ParseNumber(pcszExpr, ppcszEnd, pcPreviousAtom);
+        pAtom = ParseNumber(pcszExpr, ppcszEnd, pcPreviousAtom, cLiteralBits);
         if (pAtom)
             break;
 
@@ -802,95 +1209,125 @@ XAtom *XEvaluator::ParseAtom(const char *pcszExpr, const char **ppcszEnd, const
 XAtom *XEvaluator::ParseFunction(const char *pcszExpr, const char **ppcszEnd, const XAtom *pcPreviousAtom)
 {
     NOREF(pcPreviousAtom);
-    static uint64_t cFunctions = XANK_ARRAY_ELEMENTS(m_sFunctions);
-    for (uint64_t i = 0; i < cFunctions; i++)
+
+    /*
+     * Scan the identifier and look it up, the cost doesn't depend on the number of functions.
+     */
+    const size_t cchName = XSymbolTable::IdentifierLength(pcszExpr);
+    uint32_t idxFunction;
+    if (   !cchName
+        || !m_FunctionTable.Lookup(pcszExpr, cchName, &idxFunction))
+        return NULL;
+
+    pcszExpr += cchName;
+    while (isspace(*pcszExpr))
+        pcszExpr++;
+
+    const std::string &scOpenParenthesis = m_pOpenParenthesisOperator->Name();
+    if (!std::strncmp(pcszExpr, scOpenParenthesis.c_str(), scOpenParenthesis.length()))
     {
-        size_t cbFunction = m_sFunctions[i].Name().length();
-        if (!std::strncmp(m_sFunctions[i].Name().c_str(), pcszExpr, cbFunction))
-        {
-            pcszExpr += cbFunction;
-            while (isspace(*pcszExpr))
-                pcszExpr++;
+        XAtom *pAtom = m_AtomArena.Alloc();
+        if (!pAtom)
+            return NULL;
+        pAtom->SetFunction(&m_sFunctions[idxFunction]);
+        *ppcszEnd = pcszExpr;
+        return pAtom;
+    }
+    return NULL;
+}
 
-            if (!std::strncmp(pcszExpr, m_pOpenParenthesisOperator->Name().c_str(),
-                            m_pOpenParenthesisOperator->Name().length()))
-            {
-                XAtom *pAtom = new(std::nothrow) XAtom;
-                if (!pAtom)
-                    return NULL;
-                pAtom->SetFunction(&m_sFunctions[i]);
-                *ppcszEnd = pcszExpr;
-                return pAtom;
-            }
+
+/**
+ * Returns the value of a digit character.
+ *
+ * @param ch                The character.
+ *
+ * @return int: The value of the digit (0 to 15) or -1 if it's not a digit.
+ */
+static inline int DigitValue(char ch)
+{
+    if (ch >= '0' && ch <= '9')
+        return ch - '0';
+    if (ch >= 'a' && ch <= 'f')
+        return ch - 'a' + 10;
+    if (ch >= 'A' && ch <= 'F')
+        return ch - 'A' + 10;
+    return -1;
+}
+
+
+/**
+ * Scans a run of digits in a given radix, whitespace between digits is skipped.
+ *
+ * @param pcszExpr          Where to start scanning.
+ * @param iRadix            The radix of the digits.
+ * @param pcDigits          Where to add the number of digits scanned.
+ * @param ppcszLastDigit    Where to store the position of the last digit scanned,
+ *                          left untouched if there are no digits.
+ *
+ * @return const char*: Where scanning stopped.
+ */
+static const char *ScanDigits(const char *pcszExpr, int iRadix, size_t *pcDigits, const char **ppcszLastDigit)
+{
+    while (*pcszExpr)
+    {
+        const int iDigit = DigitValue(*pcszExpr);
+        if (iDigit >= 0 && iDigit < iRadix)
+        {
+            ++*pcDigits;
+            *ppcszLastDigit = pcszExpr;
         }
+        else if (!isspace(*pcszExpr))
+            break;
+
+        pcszExpr++;
     }
-    return NULL;
+    return pcszExpr;
 }
 
 
-XAtom *XEvaluator::ParseNumber(const char *pcszExpr, const char **ppcszEnd, const XAtom *pcPreviousAtom)
+XAtom *XEvaluator::ParseNumber(const char *pcszExpr, const char **ppcszEnd, const XAtom *pcPreviousAtom,
+                               mp_bitcnt_t cLiteralBits)
 {
     NOREF(pcPreviousAtom);
-    std::string sNum;
-    const char *pcszStart = pcszExpr;
+    const char *pcszStart     = pcszExpr;
+    const char *pcszDigits    = NULL;   /* The first digit. */
+    const char *pcszLastDigit = NULL;   /* The last digit. */
+    size_t cDigits            = 0;      /* Number of digits, including the decimal point, excluding whitespace. */
     int iRadix = 0;
     bool fFloat = false;
 
+    /*
+     * The number is never copied while scanning, we only note where its digits are.
+     */
+
     /*
      * Binary prefix.
      */
     if (*pcszExpr == 'b' || *pcszExpr == 'B')
     {
-        ++pcszExpr;
-        while (*pcszExpr)
-        {
-            if (*pcszExpr == '1' || *pcszExpr == '0')
-                sNum += *pcszExpr;
-            else if (!isspace(*pcszExpr))
-                break;
-
-            pcszExpr++;
-        }
-        iRadix = 2;
+        pcszDigits = ++pcszExpr;
+        pcszExpr   = ScanDigits(pcszExpr, 2, &cDigits, &pcszLastDigit);
+        iRadix     = 2;
     }
     else if (*pcszExpr == '0')
     {
         /*
          * Octal prefix.
          */
-        ++pcszExpr;
-        while (*pcszExpr)
-        {
-            if (*pcszExpr >= '0' && *pcszExpr < '8')
-                sNum += *pcszExpr;
-            else if (!isspace(*pcszExpr))
-                break;
-
-            pcszExpr++;
-        }
-        iRadix = 8;
+        pcszDigits = ++pcszExpr;
+        pcszExpr   = ScanDigits(pcszExpr, 8, &cDigits, &pcszLastDigit);
+        iRadix     = 8;
 
         /*
          * Hexadecimal prefix.
          */
-        if (   sNum.empty()
+        if (   !cDigits
             && (*pcszExpr == 'x' || *pcszExpr == 'X'))
         {
-            ++pcszExpr;
-            while (*pcszExpr)
-            {
-                if (   isdigit(*pcszExpr)
-                    || (*pcszExpr >= 'a' && *pcszExpr <= 'f')
-                    || (*pcszExpr >= 'A' && *pcszExpr <= 'F'))
-                {
-                    sNum += *pcszExpr;
-                }
-                else if (!isspace(*pcszExpr))
-                    break;
-
-                pcszExpr++;
-            }
-            iRadix = 16;
+            pcszDigits = ++pcszExpr;
+            pcszExpr   = ScanDigits(pcszExpr, 16, &cDigits, &pcszLastDigit);
+            iRadix     = 16;
         }
     }
 
@@ -898,9 +1335,10 @@ XAtom *XEvaluator::ParseNumber(const char *pcszExpr, const char **ppcszEnd, cons
      * No explicit number prefixes, we fall back to parsing numbers based
      * on default settings.
      */
-    if (sNum.empty())
+    if (!cDigits)
     {
-        pcszExpr = pcszStart;
+        pcszExpr   = pcszStart;
+        pcszDigits = pcszStart;
         iRadix = 0;
 
         /*
@@ -910,7 +1348,6 @@ XAtom *XEvaluator::ParseNumber(const char *pcszExpr, const char **ppcszEnd, cons
         {
             if (isdigit(*pcszExpr))
             {
-                sNum += *pcszExpr;
                 iRadix = 10;
             }
             else if (*pcszExpr == '.')
@@ -918,7 +1355,6 @@ XAtom *XEvaluator::ParseNumber(const char *pcszExpr, const char **ppcszEnd, cons
                 if (   fFloat == false
                     && (iRadix == 0 || iRadix == 10))  /* eg: ".5" or "2.5" */
                 {
-                    sNum += *pcszExpr;
                     iRadix = 10;
                     fFloat = true;
                 }
@@ -932,24 +1368,28 @@ XAtom *XEvaluator::ParseNumber(const char *pcszExpr, const char **ppcszEnd, cons
                      || (*pcszExpr >= 'a' && *pcszExpr <= 'f'))
             {
                 if (fFloat == false)    /* eg: "af" or "53a"  */
-                {
                     iRadix = 16;
-                    sNum += *pcszExpr;
-                }
                 else                    /* eg: ".af" */
                 {
                     iRadix = -1;
                     break;
                 }
             }
-            else if (!isspace(*pcszExpr))
+            else if (isspace(*pcszExpr))
+            {
+                pcszExpr++;
+                continue;
+            }
+            else
                 break;
 
+            ++cDigits;
+            pcszLastDigit = pcszExpr;
             pcszExpr++;
         }
     }
 
-    if (   sNum.empty()
+    if (   !cDigits
         || iRadix == -1)
     {
         pcszExpr = pcszStart;
@@ -957,17 +1397,66 @@ XAtom *XEvaluator::ParseNumber(const char *pcszExpr, const char **ppcszEnd, cons
     }
 
     Assert(iRadix != 0);
+    Assert(pcszDigits && pcszLastDigit);
+
+    XAtom *pAtom = m_AtomArena.Alloc();
+    if (!pAtom)
+        return NULL;
+
+    /*
+     * Integers in a power-of-two radix are packed directly into limbs, straight from the
+     * expression when the digits are contiguous.
+     */
+    const bool fContiguous       = (size_t)(pcszLastDigit - pcszDigits) + 1 == cDigits;
+    const unsigned cBitsPerDigit = iRadix == 2 ? 1 : iRadix == 8 ? 3 : iRadix == 16 ? 4 : 0;
+    if (   !fFloat
+        && cBitsPerDigit
+        && fContiguous)
+    {
+        pAtom->SetIntegerFromPow2Digits(pcszDigits, cDigits, cBitsPerDigit);
+        if (!pAtom->IsSmallInteger())
+            m_AtomArena.TrackOwner(pAtom);
+        *ppcszEnd = pcszExpr;
+        return pAtom;
+    }
+
+    /*
+     * Otherwise gather the digits, zero terminated as GMP wants them for other radices. Short
+     * numbers are gathered on the stack, longer ones in a buffer that is kept around across
+     * parses. Contiguous digits, by far the common case, are copied in one go.
+     */
+    char szBuf[64];
+    char *pszDigits = szBuf;
+    if (cDigits >= sizeof(szBuf))
+    {
+        m_NumberBuf.resize(cDigits + 1);
+        pszDigits = &m_NumberBuf[0];
+    }
+
+    if (fContiguous)
+        std::memcpy(pszDigits, pcszDigits, cDigits);
+    else
+    {
+        size_t cCopied = 0;
+        for (const char *pcsz = pcszDigits; cCopied < cDigits; pcsz++)
+        {
+            if (!isspace(*pcsz))
+                pszDigits[cCopied++] = *pcsz;
+        }
+    }
+    pszDigits[cDigits] = '\0';
 
     /*
      * We've parsed a number in a known radix, construct a number Atom for it.
      */
-    XAtom *pAtom = new(std::nothrow) XAtom;
-    if (!pAtom)
-        return NULL;
     if (fFloat)
-        pAtom->SetFloatFromStr(sNum.c_str(), iRadix);
+        pAtom->SetFloatFromStr(pszDigits, iRadix, cLiteralBits);
+    else if (cBitsPerDigit)
+        pAtom->SetIntegerFromPow2Digits(pszDigits, cDigits, cBitsPerDigit);
     else
-        pAtom->SetIntegerFromStr(sNum.c_str(), iRadix);
+        pAtom->SetIntegerFromStr(pszDigits, iRadix);
+    if (!pAtom->IsSmallInteger())
+        m_AtomArena.TrackOwner(pAtom);
     *ppcszEnd = pcszExpr;
     return pAtom;
 }
@@ -975,25 +1464,32 @@ XAtom *XEvaluator::ParseNumber(const char *pcszExpr, const char **ppcszEnd, cons
 
 XAtom *XEvaluator::ParseOperator(const char *pcszExpr, const char **ppcszEnd, const XAtom *pcPreviousAtom)
 {
-    for (size_t i = 0; i < m_cOperators; i++)
+    /*
+     * Find all operator names that are a prefix of the expression in one pass, longest
+     * name first, and among the same name the operator taking more parameters first.
+     */
+    XOperatorMatch aMatches[XANK_MAX_OPERATOR_NAME_LEN];
+    const size_t cMatches = m_OperatorTrie.Match(pcszExpr, aMatches, XANK_ARRAY_ELEMENTS(aMatches));
+    for (size_t i = 0; i < cMatches; i++)
     {
-        size_t cbOperator = m_sOperators[i].Name().length();
-        if (!std::strncmp(m_sOperators[i].Name().c_str(), pcszExpr, cbOperator))
+        for (size_t k = 0; k < aMatches[i].cOperators; k++)
         {
+            const XOperator *pcOperator = aMatches[i].papcOperators[k];
+
             /*
              * Verify if there are enough parameters on the queue for left associative operators.
              * e.g for binary '-', the previous atom must exist and must not be an open parenthesis or any
              * other operator.
              */
-            if (m_sOperators[i].Dir() == enmOperatorDirLeft)
+            if (pcOperator->Dir() == enmOperatorDirLeft)
             {
                 /* e.g: "-4" */
                 if (!pcPreviousAtom)
                     continue;
 
                 /*
-                 * pPreviousAtom should never be close parentheis as it's deleted in Parse(),
-                 * but included in here for the logical completeness.
+                 * pcPreviousAtom may be a close parenthesis, Atoms live in the Atom arena until the
+                 * whole expression is parsed, and it ends an operand like a number does.
                  */
 
                 /* e.g: "(-4"  and "(expr)-4" */
@@ -1002,12 +1498,11 @@ XAtom *XEvaluator::ParseOperator(const char *pcszExpr, const char **ppcszEnd, co
                     continue;
             }
 
-            XAtom *pAtom = new(std::nothrow) XAtom;
+            XAtom *pAtom = m_AtomArena.Alloc();
             if (!pAtom)
                 return NULL;
-            pAtom->SetOperator(&m_sOperators[i]);
-            pcszExpr += cbOperator;
-            *ppcszEnd = pcszExpr;
+            pAtom->SetOperator(pcOperator);
+            *ppcszEnd = pcszExpr + aMatches[i].cchName;
             return pAtom;
         }
     }
@@ -1030,44 +1525,208 @@ XAtom *XEvaluator::ParseCommand(const char *pcszExpr,  const char **ppcszEnd,  c
     return NULL;
 }
 
-void XEvaluator::DumpAtomStack(std::stack<XAtom *> *pStack)
+void XEvaluator::DumpAtomStack(const std::vector<XAtom*> &Stack)
+{
+    for (size_t i = Stack.size(); i-- > 0; )
+        DEBUGPRINTF(("DumpStack> %s\n", Stack[i]->PrintToString().c_str()));
+}
+
+
+void XEvaluator::DumpAtomQueue(const std::vector<XAtom*> &Queue)
+{
+    for (size_t i = 0; i < Queue.size(); i++)
+        DEBUGPRINTF(("DumpQueue> %s\n", Queue[i]->PrintToString().c_str()));
+}
+
+
+/**
+ * Returns the Atom in a register machine operand slot.
+ */
+static inline XAtom *RegisterSlot(const XProgram *pcProgram, std::vector<XAtom> &Registers, size_t cConstants,
+                                  uint32_t idxSlot)
 {
-    std::stack<XAtom *>TempStack;
-    const size_t cItems = pStack->size();
-    for (size_t i = 0; i < cItems; i++)
+    if (idxSlot < cConstants)
+        return const_cast<XAtom *>(pcProgram->Constant(idxSlot));
+    return &Registers[idxSlot - cConstants];
+}
+
+
+int XEvaluator::EvaluateRegisters(const XProgram *pcProgram, XAtom *pResult)
+{
+    /*
+     * The registers are kept across evaluations like the frame is, so intermediates keep their
+     * GMP limbs. Operands are passed where they are, constants included, only the first one is
+     * copied to the destination register unless it's already there.
+     */
+    if (m_Registers.size() < pcProgram->m_cRegisters)
+        m_Registers.resize(pcProgram->m_cRegisters);
+    if (m_apOperands.size() < XANK_MAX(pcProgram->m_cMaxParams, 1))
+        m_apOperands.resize(XANK_MAX(pcProgram->m_cMaxParams, 1));
+
+    const size_t cConstants    = pcProgram->m_Constants.size();
+    const uint32_t *paOperands = pcProgram->m_RegOperands.empty() ? NULL : &pcProgram->m_RegOperands[0];
+    XAtom **papAtoms           = &m_apOperands[0];
+    int rc                     = INF_SUCCESS;
+    for (size_t i = 0; i < pcProgram->m_RegInstructions.size(); i++)
     {
-        XAtom *pAtom = pStack->top();
-        TempStack.push(pAtom);
-        pStack->pop();
+        const XRegInstruction *pcInstr = &pcProgram->m_RegInstructions[i];
+        XAtom *pDst = &m_Registers[pcInstr->idxDst];
+        switch (pcInstr->enmOp)
+        {
+            case enmInstructionOpMove:
+                *pDst = *RegisterSlot(pcProgram, m_Registers, cConstants, pcInstr->idxOperands);
+                break;
+
+            case enmInstructionOpToFloat:
+                pDst->MutableFloat(pcInstr->cFloatBits);
+                break;
+
+            case enmInstructionOpOperator:
+            case enmInstructionOpOperatorInteger:
+            case enmInstructionOpOperatorFloat:
+            case enmInstructionOpOperatorFixed:
+            case enmInstructionOpFunction:
+            {
+                const size_t cParams       = pcInstr->cParams;
+                const uint32_t *paidxSlots = &paOperands[pcInstr->idxOperands];
+                if (cParams)
+                {
+                    XAtom *pFirst = RegisterSlot(pcProgram, m_Registers, cConstants, paidxSlots[0]);
+                    if (pFirst != pDst)
+                        *pDst = *pFirst;
+                }
+                else
+                    *pDst = XAtom();
+
+                papAtoms[0] = pDst;
+                for (size_t k = 1; k < cParams; k++)
+                    papAtoms[k] = RegisterSlot(pcProgram, m_Registers, cConstants, paidxSlots[k]);
 
-        DEBUGPRINTF(("DumpStack> %s\n", pAtom->PrintToString().c_str()));
+                if (pcInstr->enmOp == enmInstructionOpFunction)
+                {
+                    if (pcInstr->u.pcFunction->Function())
+                    {
+                        m_ScratchPool.SetFloatPrecision(pcInstr->cFloatBits);
+                        rc = pcInstr->u.pcFunction->Invoke(papAtoms, cParams, &m_ScratchPool);
+                    }
+                    if (IS_FAILURE(rc))
+                    {
+                        CleanUp(rc, "Function %s failed with given operands.\n", pcInstr->u.pcFunction->Name().c_str());
+                        return rc;
+                    }
+                }
+                else
+                {
+                    const XOperator *pcOperator = pcInstr->u.pcOperator;
+                    void *pvData;
+                    PFNOPERATOR pfnOperator = OperatorFunction(pcProgram, pcInstr->enmOp, pcOperator, pcInstr->cFloatBits,
+                                                               &m_ScratchPool, &pvData);
+                    if (pfnOperator)
+                        rc = pfnOperator(papAtoms, cParams, pvData);
+                    if (IS_FAILURE(rc))
+                    {
+                        CleanUp(rc, "Operator %s failed on given operands.", pcOperator->Name().c_str());
+                        return rc;
+                    }
+                }
+                break;
+            }
+
+            default:
+            {
+                DEBUGPRINTF(("Wow, an undiscovered register Instruction!\n"));
+                rc = ERR_INVALID_RPN;
+                CleanUp(rc, "Invalid Instruction in program.\n");
+                return rc;
+            }
+        }
     }
 
-    for (size_t i = 0; i < cItems; i++)
+    if (pResult)
     {
-        pStack->push(TempStack.top());
-        TempStack.pop();
+        for (size_t i = 0; i < pcProgram->m_RegResults.size(); i++)
+        {
+            pResult[i] = *RegisterSlot(pcProgram, m_Registers, cConstants, pcProgram->m_RegResults[i]);
+            pcProgram->m_FixedWidth.Widen(&pResult[i]);
+        }
     }
+
+    CleanUp(INF_SUCCESS, "Expression evaluated successfully.\n");
+    return INF_SUCCESS;
 }
 
 
-void XEvaluator::DumpAtomQueue(std::queue<XAtom *> *pQueue)
+bool XEvaluator::EvaluateDoubles(const XProgram *pcProgram, XAtom *pResult)
 {
-    std::queue<XAtom *>TempQueue;
-    const size_t cItems = pQueue->size();
-    for (size_t i = 0; i < cItems; i++)
+    if (m_DoubleFrame.size() < pcProgram->MaxStackDepth())
+        m_DoubleFrame.resize(pcProgram->MaxStackDepth());
+    if (m_DoubleTemps.size() < pcProgram->Temps())
+        m_DoubleTemps.resize(pcProgram->Temps());
+
+    /*
+     * PrepareDoubleTier() made sure there are only these Instructions. The operand of a
+     * PushConstantOperator is simply pushed, the Operator Instruction after it follows.
+     */
+    XBoundedDouble *paFrame = &m_DoubleFrame[0];
+    size_t cStack           = 0;
+    const XInstruction *pcInstr    = pcProgram->Instructions();
+    const XInstruction *pcInstrEnd = pcInstr + pcProgram->Size();
+    for (; pcInstr < pcInstrEnd; pcInstr++)
     {
-        XAtom *pAtom = pQueue->front();
-        TempQueue.push(pAtom);
-        pQueue->pop();
+        Assert(cStack <= pcProgram->MaxStackDepth());
+        switch (pcInstr->enmOp)
+        {
+            case enmInstructionOpPushConstant:
+            case enmInstructionOpPushConstantOperator:
+                paFrame[cStack++] = pcProgram->m_DoubleConstants[pcInstr->u.idxConstant];
+                break;
+
+            case enmInstructionOpStore:
+                m_DoubleTemps[pcInstr->u.idxTemp] = paFrame[cStack - 1];
+                break;
+
+            case enmInstructionOpLoad:
+                paFrame[cStack++] = m_DoubleTemps[pcInstr->u.idxTemp];
+                break;
 
-        DEBUGPRINTF(("DumpQueue> %s\n", pAtom->PrintToString().c_str()));
+            default:
+            {
+                const size_t cParams = pcInstr->cParams;
+                Assert(cParams > 0 && cParams <= cStack);
+                pcInstr->u.pcOperator->DoubleFunction()(&paFrame[cStack - cParams], cParams);
+                cStack -= cParams - 1;
+                break;
+            }
+        }
     }
 
-    for (size_t i = 0; i < cItems; i++)
+    /*
+     * Every result must be finite and accurate enough, a NaN error never is.
+     */
+    Assert(cStack == pcProgram->Results());
+    for (size_t i = 0; i < cStack; i++)
     {
-        pQueue->push(TempQueue.front());
-        TempQueue.pop();
+        const double rMagnitude = std::fabs(paFrame[i].rValue);
+        if (   !(rMagnitude <= DBL_MAX)
+            || !(paFrame[i].rError <= pcProgram->m_rDoubleTolerance * rMagnitude))
+        {
+            DEBUGPRINTF(("Double tier result %g is off by up to %g, evaluating with GMP floats.\n",
+                         paFrame[i].rValue, paFrame[i].rError));
+            return false;
+        }
+    }
+
+    /* With the precision the GMP floats would have given, a result Atom may still have another one. */
+    if (pResult)
+    {
+        const mp_bitcnt_t cBits = pcProgram->m_cFloatBits ? pcProgram->m_cFloatBits : mpf_get_default_prec();
+        for (size_t i = 0; i < cStack; i++)
+        {
+            mpf_ptr pFloat = pResult[i].MutableFloat(cBits);
+            mpf_set_prec(pFloat, cBits);
+            mpf_set_d(pFloat, paFrame[i].rValue);
+        }
     }
+    return true;
 }
 
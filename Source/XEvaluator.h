@@ -22,16 +22,21 @@
 #ifndef XANK_EVALUATOR_H
 # define XANK_EVALUATOR_H
 
-#include <queue>
 #include <list>
 #include <string>
-#include <stack>
+#include <vector>
 
 #include "Settings.h"
+#include "XAtomArena.h"
+#include "XOperator.h"
+#include "XOperatorTrie.h"
+#include "XScratchPool.h"
+#include "XSymbolTable.h"
 
 class XAtom;
 class XFunction;
 class XOperator;
+class XProgram;
 
 /**
  * Expression evaluator.
@@ -61,6 +66,61 @@ class XEvaluator
          */
         int                         Parse(const char *pcszExr);
 
+        /**
+         * Parses an expression into a Program which can be evaluated any number of
+         * times. The caller owns the returned Program and must delete it.
+         *
+         * @param pcszExpr          The expression to parse.
+         * @param ppProgram         Where to store the newly allocated Program.
+         *
+         * @return int: xank error code.
+         */
+        int                         Parse(const char *pcszExpr, XProgram **ppProgram);
+
+        /**
+         * Parses an expression into a Program whose float results are computed to the
+         * given number of significant decimal digits, see XANK_SETTING_FLOAT_DIGITS.
+         * The caller owns the returned Program and must delete it.
+         *
+         * @param pcszExpr          The expression to parse.
+         * @param cFloatDigits      Number of significant decimal digits of float results,
+         *                          0 for the GMP default precision.
+         * @param ppProgram         Where to store the newly allocated Program.
+         *
+         * @return int: xank error code.
+         */
+        int                         Parse(const char *pcszExpr, uint32_t cFloatDigits, XProgram **ppProgram);
+
+        /**
+         * Parses a batch of expressions into a single Program with one result per
+         * expression. Subexpressions shared by the expressions are evaluated once
+         * per evaluation of the batch. The caller owns the returned Program and must
+         * delete it.
+         *
+         * @param papcszExprs       Array of the expressions to parse.
+         * @param cExprs            Number of items in @a papcszExprs.
+         * @param ppProgram         Where to store the newly allocated Program.
+         *
+         * @return int: xank error code.
+         */
+        int                         ParseBatch(const char * const *papcszExprs, size_t cExprs, XProgram **ppProgram);
+
+        /**
+         * Parses a batch of expressions into a single Program, like ParseBatch() above,
+         * with the float results computed to the given number of significant decimal
+         * digits instead of XANK_SETTING_FLOAT_DIGITS.
+         *
+         * @param papcszExprs       Array of the expressions to parse.
+         * @param cExprs            Number of items in @a papcszExprs.
+         * @param cFloatDigits      Number of significant decimal digits of float results,
+         *                          0 for the GMP default precision.
+         * @param ppProgram         Where to store the newly allocated Program.
+         *
+         * @return int: xank error code.
+         */
+        int                         ParseBatch(const char * const *papcszExprs, size_t cExprs, uint32_t cFloatDigits,
+                                               XProgram **ppProgram);
+
         /**
          * Evaluates the internal representation of the previously parsed expression.
          * The logic is roughly reverse polish notation but modified to support
@@ -70,7 +130,42 @@ class XEvaluator
          */
         int                         Evaluate();
 
+        /**
+         * Evaluates a Program. The Program is not modified and can be evaluated
+         * again. Evaluation works on a frame of Atoms owned by the evaluator, sized
+         * to the maximum stack depth of the Program.
+         *
+         * @param pcProgram         The Program to evaluate.
+         * @param pResult           Where to store the result, optional (can be NULL).
+         *                          For a batch Program, an array of
+         *                          pcProgram->Results() Atoms for the results in
+         *                          expression order.
+         *
+         * @return int: xank error code.
+         */
+        int                         Evaluate(const XProgram *pcProgram, XAtom *pResult);
+
+        /**
+         * Returns the settings of this evaluator, e.g. to toggle optimizations. See
+         * the XANK_SETTING_XXX keys.
+         *
+         * @return Settings*: Pointer to the settings.
+         */
+        Settings                   *EvaluatorSettings();
+
     private:
+        /**
+         * Parses an expression and compiles it into a Program, after any expressions
+         * already compiled into it. Allocates the Atoms from the Atom arena, the
+         * caller resets the arena.
+         *
+         * @param pcszExpr          The expression to parse.
+         * @param pProgram          The Program to compile into.
+         *
+         * @return int: xank error code.
+         */
+        int                         ParseExpression(const char *pcszExpr, XProgram *pProgram);
+
         /**
          * Parses the expression for an Atom.
          *
@@ -79,10 +174,13 @@ class XEvaluator
          *                          parsed.
          * @param pcPreviousAtom    Pointer to the previously parsed Atom, must be NULL
          *                          on first call of an expression.
+         * @param cLiteralBits      Precision to read float literals with, 0 for the GMP
+         *                          default.
          *
-         * @return Atom*: A newly allocated Atom or NULL if no atoms were parsed.
+         * @return Atom*: An Atom allocated from the Atom arena or NULL if no atoms were parsed.
          */
-        XAtom                      *ParseAtom(const char *pcszExpr, const char **ppcszEnd, const XAtom *pcPreviousAtom);
+        XAtom                      *ParseAtom(const char *pcszExpr, const char **ppcszEnd, const XAtom *pcPreviousAtom,
+                                              mp_bitcnt_t cLiteralBits);
 
         /**
          * Parses the expression for a function.
@@ -93,7 +191,7 @@ class XEvaluator
          * @param pcPreviousAtom    Pointer to the previously parsed Atom, must be NULL
          *                          on the first call of an expression.
          *
-         * @return Atom*: A newly allocated Atom or NULL if no functions were parsed.
+         * @return Atom*: An Atom allocated from the Atom arena or NULL if no functions were parsed.
          */
         XAtom                      *ParseFunction(const char *pcszexpr, const char **ppcszEnd, const XAtom *pcPreviousAtom);
 
@@ -105,10 +203,13 @@ class XEvaluator
          *                          parsed.
          * @param pcPreviousAtom    Pointer to the previously parsed Atom, must be NULL
          *                          on the first call of an expression.
+         * @param cLiteralBits      Precision to read float literals with, 0 for the GMP
+         *                          default.
          *
-         * @return Atom*: A newly allocated Atom or NULL if no numbers were parsed.
+         * @return Atom*: An Atom allocated from the Atom arena or NULL if no numbers were parsed.
          */
-        XAtom                      *ParseNumber(const char *pcszExpr, const char **ppcszEnd, const XAtom *cpPreviousAtom);
+        XAtom                      *ParseNumber(const char *pcszExpr, const char **ppcszEnd, const XAtom *cpPreviousAtom,
+                                                mp_bitcnt_t cLiteralBits);
 
         /**
          * Parses the expression for an operator.
@@ -119,7 +220,7 @@ class XEvaluator
          * @param pcPreviousAtom    Pointer to the previously parsed Atom, must be NULL
          *                          on the first call of an expression.
          *
-         * @return Atom*: A newly allocated Atom or NULL if no operators were parsed.
+         * @return Atom*: An Atom allocated from the Atom arena or NULL if no operators were parsed.
          */
         XAtom                      *ParseOperator(const char *pcszExpr, const char **ppcszEnd, const XAtom *pcPreviousAtom);
 
@@ -132,7 +233,7 @@ class XEvaluator
          * @param pcPreviousAtom    Pointer to the previously parsed Atom, must be NULL
          *                          on the first call of an expression.
          *
-         * @return Atom*: A newly allocated Atom or NULL if no variables were parsed.
+         * @return Atom*: An Atom allocated from the Atom arena or NULL if no variables were parsed.
          */
         XAtom                      *ParseVariable(const char *pcszExpr, const char **ppcszEnd, const XAtom *pcPreviousAtom);
 
@@ -145,45 +246,206 @@ class XEvaluator
          * @param pcPreviousAtom    Pointer to the previously parsed Atom, must be NULL
          *                          on the first call of an expression.
          *
-         * @return Atom*: A newly allocated Atom or NULL if no commands were parsed.
+         * @return Atom*: An Atom allocated from the Atom arena or NULL if no commands were parsed.
          */
         XAtom                      *ParseCommand(const char *pcszExpr, const char **ppcszEnd, const XAtom *pcPreviousAtom);
 
         /**
-         * Clean up evaluator state and sets up error object accordingly.
+         * Compiles the RPN queue produced by the parser into a Program, lowering it
+         * to a contiguous array of Instructions and a constant pool. The Instructions
+         * are appended, leaving one more result on the operand stack.
+         *
+         * @param Queue             The RPN queue. Number values are moved out of its
+         *                          Atoms, which are released with the Atom arena.
+         * @param pProgram          The Program to compile into.
+         *
+         * @return int: xank error code.
+         */
+        int                         Compile(const std::vector<XAtom*> &Queue, XProgram *pProgram);
+
+        /**
+         * Evaluates a Program lowered for the register machine.
+         *
+         * @param pcProgram         The Program to evaluate.
+         * @param pResult           Where to store the results, optional (can be NULL).
+         *
+         * @return int: xank error code.
+         */
+        int                         EvaluateRegisters(const XProgram *pcProgram, XAtom *pResult);
+
+        /**
+         * Evaluates a Program in doubles, see XANK_SETTING_DOUBLE_TIER.
+         *
+         * @param pcProgram         The Program to evaluate, prepared for the double tier.
+         * @param pResult           Where to store the results, optional (can be NULL).
+         *
+         * @return bool: true if the results are accurate enough, false if the Program
+         *         must be evaluated with GMP floats.
+         */
+        bool                        EvaluateDoubles(const XProgram *pcProgram, XAtom *pResult);
+
+        /**
+         * Runs the optimization passes enabled in the settings on a compiled Program.
+         *
+         * @param pProgram          The compiled Program.
+         *
+         * @return int: xank error code.
+         */
+        int                         Optimize(XProgram *pProgram);
+
+        /**
+         * Converts the constants of a Program with fixed-width integers to that width,
+         * and turns its Operators into Instructions invoking their fixed-width function.
+         * Runs before any optimization pass, so they all see fixed-width arithmetic.
+         *
+         * @param pProgram          The compiled Program.
+         *
+         * @return int: xank error code, ERR_NOT_SUPPORTED if the Program invokes a
+         *         Function or an Operator without a fixed-width function.
+         */
+        int                         NarrowIntegers(XProgram *pProgram);
+
+        /**
+         * Evaluates Operators whose operands are all constants and replaces them with
+         * their result. Functions are never folded.
+         *
+         * @param pProgram          The compiled Program.
+         *
+         * @return int: xank error code.
+         */
+        int                         FoldConstants(XProgram *pProgram);
+
+        /**
+         * Computes repeated subexpressions once, storing the result of the first
+         * occurrence in a temporary which the others load. Functions are assumed to be
+         * pure.
+         *
+         * @param pProgram          The compiled Program.
+         *
+         * @return int: xank error code.
+         */
+        int                         EliminateCommonSubexpressions(XProgram *pProgram);
+
+        /**
+         * Infers the types of operands from the constants, and turns Operators on
+         * operands of known types into Instructions invoking the Operator function
+         * specialised for them. Integer operands of a float Operator are promoted,
+         * constants right away.
+         *
+         * @param pProgram          The compiled Program.
+         *
+         * @return int: xank error code.
+         */
+        int                         SpecializeTypes(XProgram *pProgram);
+
+        /**
+         * Collapses chains of an associative Operator, e.g. a + b + c + d, into a
+         * single n-ary Operator Instruction. Only integer Instructions are reassociated,
+         * e.g. a + (b + c), as that would change float results.
+         *
+         * @param pProgram          The compiled Program.
+         *
+         * @return int: xank error code.
+         */
+        int                         FuseOperators(XProgram *pProgram);
+
+        /**
+         * Derives the precision of every float operation from the precision the results
+         * must be accurate to, see XANK_SETTING_FLOAT_DIGITS. An operation's result
+         * goes into its first operand, so the precisions are set on the constants the
+         * chains of first operands start from, and on the Instructions promoting
+         * integers to floats. Runs once, on the Instructions as compiled, before any
+         * of the passes which keep the precisions.
+         *
+         * @param pProgram          The compiled Program.
+         *
+         * @return int: xank error code.
+         */
+        int                         PlanPrecisions(XProgram *pProgram);
+
+        /**
+         * Lowers the Instructions of a Program to three-address Instructions for the
+         * register machine, see XANK_SETTING_REGISTER_MACHINE. Every intermediate is
+         * assigned a register, Programs too large for that stay on the stack machine.
+         *
+         * @param pProgram          The compiled Program.
+         *
+         * @return int: xank error code.
+         */
+        int                         AllocateRegisters(XProgram *pProgram);
+
+        /**
+         * Combines common sequences of Instructions into superinstructions, evaluated
+         * with a single dispatch. Must be the last pass, the others don't know them.
+         *
+         * @param pProgram          The compiled Program.
+         *
+         * @return int: xank error code.
+         */
+        int                         FormSuperinstructions(XProgram *pProgram);
+
+        /**
+         * Prepares a Program that only computes with floats for evaluating it in
+         * doubles first, converting its constants. Programs that don't qualify are
+         * left as they are.
+         *
+         * @param pProgram          The compiled Program.
+         * @param cDigits           Number of significant decimal digits results of the
+         *                          double tier must be accurate to.
+         */
+        void                        PrepareDoubleTier(XProgram *pProgram, uint32_t cDigits);
+
+        /**
+         * Sets up error object according to the result of an operation.
          *
-         * @param pStack            Pointer to the current stack.
          * @param rc                The error code.
          * @param pcszError         The string describing the error and required
          *                          details, va_args style.
          */
-        void                        CleanUp(std::stack<XAtom*> *pStack, std::queue<XAtom*> *pQueue, int rc, const char *pcszError, ...);
+        void                        CleanUp(int rc, const char *pcszError, ...);
 
         /**
-         * Dumps a given stack of Atoms to debug output.
+         * Dumps a given stack of Atoms to debug output, top first.
          *
-         * @param pQueue            Pointer to the queue of Atoms.
+         * @param Stack             The stack of Atoms.
          */
-        void                        DumpAtomStack(std::stack<XAtom *> *pStack);
+        void                        DumpAtomStack(const std::vector<XAtom*> &Stack);
 
         /**
          * Dumps a given queue of Atoms to debug output.
          *
-         * @param pQueue            Pointer to the queue of Atoms.
+         * @param Queue             The queue of Atoms.
          */
-        void                        DumpAtomQueue(std::queue<XAtom *> *pQueue);
+        void                        DumpAtomQueue(const std::vector<XAtom*> &Queue);
 
         bool                        m_fInitialized; /**< Whether this object has been successfully initialized. */
         std::string                 m_sExpr;        /**< The full, unmodified expression */
-        std::queue<XAtom*>          m_RPNQueue;     /**< Internal RPN representation done at the parsing stage. */
+        std::vector<char>           m_NumberBuf;    /**< Scratch buffer for converting long numbers, reused across parses. */
+        XProgram                   *m_pProgram;     /**< Program of the last expression passed to Parse(). */
+        std::vector<XAtom*>         m_ParseStack;   /**< Operator stack of the parser, reused across parses. */
+        std::vector<XAtom*>         m_ParseQueue;   /**< RPN output of the parser, reused across parses. */
+        std::vector<XAtom>          m_Frame;        /**< Operand stack of the evaluator by value, reused across evaluations. */
+        std::vector<XAtom*>         m_apFrame;      /**< Pointers to the Atoms in m_Frame, operands are passed as slices of it. */
+        std::vector<XAtom>          m_Temps;        /**< Temporaries for Store and Load Instructions, reused across evaluations. */
+        std::vector<XAtom>          m_Registers;    /**< Registers of the register machine, reused across evaluations. */
+        std::vector<XAtom*>         m_apOperands;   /**< Operands of the register machine Instruction being evaluated. */
+        std::vector<int64_t>        m_aiNativeResults; /**< Results of native code, reused across evaluations. */
+        std::vector<int64_t>        m_aiNativeTemps;   /**< Temporaries of native code, reused across evaluations. */
+        std::vector<XBoundedDouble> m_DoubleFrame;  /**< Operand stack of the double tier, reused across evaluations. */
+        std::vector<XBoundedDouble> m_DoubleTemps;  /**< Temporaries of the double tier, reused across evaluations. */
         std::list<XAtom*>           m_VarList;      /**< List of variables being evaulated, used for circular dependency checks. */
         std::string                 m_sError;       /**< The last error's descriptive string. */
         int                         m_Error;        /**< The last error. */
         static const XFunction      m_sFunctions[]; /**< Static array of Function objects. */
+        static const size_t         m_cFunctions;   /**< Static count of Functions in Function objects array. */
         static const XOperator      m_sOperators[]; /**< Static array of Operator objects. */
         static const size_t         m_cOperators;   /**< Static count of Operators in Operator objects array. */
         Settings                    m_Setttings;    /**< Settings for evaluator. */
         const XOperator            *m_pOpenParenthesisOperator;  /**< Pointer to open parenthesis operator. */
+        XOperatorTrie               m_OperatorTrie; /**< Operator name matcher built from the Operator array. */
+        XSymbolTable                m_FunctionTable;/**< Function name to Function array index lookup table. */
+        XAtomArena                  m_AtomArena;    /**< Allocator for the Atoms of the expression being parsed. */
+        XScratchPool                m_ScratchPool;  /**< GMP temporaries for Operators and Functions, kept across evaluations. */
 };
 
 #endif /* XANK_EVALUATOR_H */
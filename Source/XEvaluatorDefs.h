@@ -25,6 +25,9 @@
 /** Maximum length of a variable name, in bytes. */
 #define XANK_MAX_VARIABLE_NAME_LEN                  128
 
+/** Maximum length of an operator name, in bytes. */
+#define XANK_MAX_OPERATOR_NAME_LEN                  8
+
 /**
  * Maximum number of parameters to an operator. Since this is a uint8_t
  * internally, it's UINT8_MAX here. If that changes this must change & vice
@@ -38,6 +41,63 @@
  */
 #define XANK_MAX_FUNCTION_PARAMETERS                SIZE_MAX
 
+/** Settings key (bool) for evaluating constant Operator subexpressions when
+ *  compiling, defaults to true. */
+#define XANK_SETTING_CONSTANT_FOLDING               "Evaluator.ConstantFolding"
+
+/** Settings key (bool) for computing repeated subexpressions only once,
+ *  defaults to true. */
+#define XANK_SETTING_COMMON_SUBEXPRESSIONS          "Evaluator.CommonSubexpressions"
+
+/** Settings key (bool) for inferring operand types when compiling and invoking
+ *  Operator functions specialised for them, defaults to true. */
+#define XANK_SETTING_TYPE_SPECIALIZATION            "Evaluator.TypeSpecialization"
+
+/** Settings key (bool) for collapsing chains of an associative Operator into a
+ *  single n-ary Operator when compiling, defaults to true. */
+#define XANK_SETTING_OPERATOR_FUSION                "Evaluator.OperatorFusion"
+
+/** Settings key (bool) for evaluating Programs on a register machine instead of
+ *  the stack machine, defaults to false. */
+#define XANK_SETTING_REGISTER_MACHINE               "Evaluator.RegisterMachine"
+
+/** Settings key (bool) for combining common sequences of Instructions into
+ *  superinstructions when compiling, defaults to true. */
+#define XANK_SETTING_SUPERINSTRUCTIONS              "Evaluator.Superinstructions"
+
+/** Settings key (bool) for compiling Programs that only compute with machine
+ *  words to native code where supported, defaults to true. */
+#define XANK_SETTING_NATIVE_CODE                    "Evaluator.NativeCode"
+
+/** Settings key (string) for the width of integers, one of u8, u16, u32, u64, i8,
+ *  i16, i32 and i64, defaults to empty for arbitrary precision integers. */
+#define XANK_SETTING_INTEGER_WIDTH                  "Evaluator.IntegerWidth"
+
+/** Settings key (bool) for saturating fixed-width integers at the limits of their
+ *  width instead of wrapping them around, defaults to false. */
+#define XANK_SETTING_INTEGER_SATURATION             "Evaluator.IntegerSaturation"
+
+/** Settings key (bool) for evaluating float Programs in doubles first, and with GMP
+ *  floats only if the result isn't accurate enough, defaults to false. */
+#define XANK_SETTING_DOUBLE_TIER                    "Evaluator.DoubleTier"
+
+/** Settings key (uint32) for the number of significant decimal digits results of
+ *  the double tier must be accurate to, defaults to 15. */
+#define XANK_SETTING_DOUBLE_TIER_DIGITS             "Evaluator.DoubleTierDigits"
+
+/** Settings key (uint32) for the number of significant decimal digits float results
+ *  must be accurate to, which the precision of every float operation is derived
+ *  from, defaults to 0 for computing with the GMP default precision throughout.
+ *  Used by the parses which aren't given the digits, see XEvaluator::ParseBatch(). */
+#define XANK_SETTING_FLOAT_DIGITS                   "Evaluator.FloatDigits"
+
+/** Maximum number of significant decimal digits of float results. */
+#define XANK_MAX_FLOAT_DIGITS                       1000000
+
+/** Guard bits for float operations whose operands may cancel, and for reading
+ *  float literals, see XANK_SETTING_FLOAT_DIGITS. */
+#define XANK_FLOAT_GUARD_BITS                       64
+
 /** Operator Id for Open Paranthesis Operator. */
 #define XANK_OPEN_PARENTHESIS_OPERATOR_ID           0
 
@@ -50,6 +110,9 @@
 /** Operator Id for Assignment Operator. */
 #define XANK_ASSIGNMENT_OPERATOR_ID                 3
 
+/** Operator Id for Addition Operator. */
+#define XANK_ADD_OPERATOR_ID                        10
+
 
 #endif /* XANK_EVALUATOR_DEFS_H */
 
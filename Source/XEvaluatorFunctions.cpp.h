@@ -19,10 +19,11 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-static int FxAdd (XAtom *apAtoms[], uint64_t cAtoms)
+static int FxAdd (XAtom *apAtoms[], uint64_t cAtoms, void *pvData)
 {
     NOREF(apAtoms);
     NOREF(cAtoms);
+    NOREF(pvData);
     return INF_SUCCESS;
 }
 
@@ -32,3 +33,5 @@ const XFunction XEvaluator::m_sFunctions[] =
     XFunction(1, SIZE_MAX, "fact",      FxAdd, "Factorial", "Returns the factorial."),
 };
 
+const size_t XEvaluator::m_cFunctions = XANK_ARRAY_ELEMENTS(m_sFunctions);
+
@@ -23,129 +23,107 @@
 #include "XAtom.h"
 #include "XErrors.h"
 #include "XGenericDefs.h"
+#include "XCheckedMath.h"
 #include "XOperator.h"
+#include "XOperatorKernels.h"
+#include "XScratchPool.h"
 #include "Debug.h"
 #include "Assert.h"
 
-/*
- * Smallest to largest type. Types that are higher
- * in this list will be promoted to those that are lower when
- * operations involving multiple types are encountered, e.g. Integer
- * gets promoted to Float.
+#include <cfloat>
+#include <climits>
+#include <cmath>
+
+/**
+ * Arithmetic of the addition Operator.
  */
-typedef enum
+struct XAddArith : public XArithBase<XAddArith>
 {
-    enmUnknown,
-    enmInteger,
-    enmFloat,
-    enmMax = enmFloat
-} NumberType;
-
+    static bool Native(int64_t iLeft, int64_t iRight, int64_t *piResult)
+    {
+        return CheckedAddS64(iLeft, iRight, piResult);
+    }
 
-static NumberType FindLargestNumberType(XAtom *apAtoms[], size_t cAtoms)
-{
-    NumberType dstType = enmUnknown;
-    for (size_t i = 0; i < cAtoms; i++)
+    static void Integer(mpz_ptr pDst, mpz_srcptr pcSrc)
     {
-        NumberType srcType;
-        Assert(apAtoms[i]->IsNumber());
-        if (apAtoms[i]->IsInteger())
-            srcType = enmInteger;
-        else if (apAtoms[i]->IsFloat())
-            srcType = enmFloat;
-
-        if (srcType >= dstType)
-            dstType = srcType;
-        if (dstType == enmMax)
-            break;
+        mpz_add(pDst, pDst, pcSrc);
     }
-    return dstType;
-}
 
+    static void Float(mpf_ptr pDst, mpf_srcptr pcSrc)
+    {
+        mpf_add(pDst, pDst, pcSrc);
+    }
 
-int OpAdd(XAtom *apAtoms[], size_t cAtoms, void *pvData)
-{
-    NOREF(pvData);
-    DEBUGPRINTF(("OpAdd\n"));
+    static uint64_t Wrapping(uint64_t uLeft, uint64_t uRight)
+    {
+        return uLeft + uRight;
+    }
 
-    /** @todo This is not all that efficient. Optimize it later. */
+    static int64_t SaturatingSigned(int64_t iLeft, int64_t iRight, int64_t iMin, int64_t iMax)
+    {
+        int64_t iResult;
+        if (CheckedAddS64(iLeft, iRight, &iResult))
+            return iRight > 0 ? iMax : iMin;
+        return XANK_MIN(XANK_MAX(iResult, iMin), iMax);
+    }
 
-    NumberType dstType = FindLargestNumberType(apAtoms, cAtoms);
-    int rc = INF_SUCCESS;
-    if (dstType == enmInteger)
+    static uint64_t SaturatingUnsigned(uint64_t uLeft, uint64_t uRight, uint64_t uMax)
     {
-        mpz_t Operand1;
-        mpz_t Operand2;
-        mpz_init(Operand1);
-        mpz_init(Operand2);
-        int rc1 = apAtoms[0]->GetInteger(Operand1);
-        int rc2 = apAtoms[1]->GetInteger(Operand2);
-        if (IS_SUCCESS(rc1) && IS_SUCCESS(rc2))
-        {
-            mpz_t Result;
-            mpz_init(Result);
-            mpz_add(Result, Operand1, Operand2);
-            apAtoms[0]->SetInteger(Result);
-            mpz_clear(Result);
-        }
-        else
-        {
-            DEBUGPRINTF(("OpAdd failed dstType=%d rc1=%d rc2=%d\n", dstType, rc1, rc2));
-            rc = ERR_INVALID_ATOM_TYPE_FOR_OPERATION;
-        }
+        return uLeft > uMax - uRight ? uMax : uLeft + uRight;
+    }
 
-        mpz_clear(Operand1);
-        mpz_clear(Operand2);
+    static XBoundedDouble Double(XBoundedDouble Left, XBoundedDouble Right)
+    {
+        /* The errors of the operands add up, plus an ulp for rounding the sum. */
+        XBoundedDouble Result;
+        Result.rValue = Left.rValue + Right.rValue;
+        Result.rError = Left.rError + Right.rError + std::fabs(Result.rValue) * DBL_EPSILON;
+        return Result;
     }
-    else if (dstType == enmFloat)
+
+#if LONG_MAX >= INT64_MAX
+    /* GMP takes small integers as longs directly, no need for scratch registers. */
+    static int IntegerSmall(mpz_ptr pDst, int64_t iValue, XScratchPool *pPool)
     {
-        mpf_t Operand1;
-        mpf_t Operand2;
-        mpf_init(Operand1);
-        mpf_init(Operand2);
-        int rc1 = apAtoms[0]->PromoteGetFloat(Operand1);
-        int rc2 = apAtoms[1]->PromoteGetFloat(Operand2);
-        if (IS_SUCCESS(rc1) && IS_SUCCESS(rc2))
-        {
-            mpf_t Result;
-            mpf_init(Result);
-            mpf_add(Result, Operand1, Operand2);
-            apAtoms[0]->SetFloat(Result);
-            mpf_clear(Result);
-        }
+        NOREF(pPool);
+        if (iValue >= 0)
+            mpz_add_ui(pDst, pDst, (unsigned long)iValue);
         else
-        {
-            DEBUGPRINTF(("OpAdd failed dstType=%d rc1=%d rc2=%d\n", dstType, rc1, rc2));
-            rc = ERR_INVALID_ATOM_TYPE_FOR_OPERATION;
-        }
-
-        mpf_clear(Operand1);
-        mpf_clear(Operand2);
+            mpz_sub_ui(pDst, pDst, 0 - (unsigned long)iValue);
+        return INF_SUCCESS;
     }
-    else
+
+    static int FloatSmall(mpf_ptr pDst, int64_t iValue, XScratchPool *pPool)
     {
-        DEBUGPRINTF(("OpAdd failed dstType=%d\n", dstType));
-        rc = ERR_INVALID_ATOM_TYPE_FOR_OPERATION;
+        NOREF(pPool);
+        if (iValue >= 0)
+            mpf_add_ui(pDst, pDst, (unsigned long)iValue);
+        else
+            mpf_sub_ui(pDst, pDst, 0 - (unsigned long)iValue);
+        return INF_SUCCESS;
     }
+#endif
+};
 
-    return rc;
-}
+/** The addition kernels. */
+typedef XOperatorKernels<XAddArith> XAddKernels;
 
 const XOperator XEvaluator::m_sOperators[] =
 {
-    /*     Id        Pri    Associativity          cParams  Name   pfn    ShortHelp             LongHelp */
+    /*     Id        Pri    Associativity          cParams  Flags                        Name   pfn                   pfnInteger            pfnFloat            pfnFixed            pfnDouble           ShortHelp             LongHelp */
     /* Special Operators */
     XOperator(XANK_OPEN_PARENTHESIS_OPERATOR_ID,
-                      99, enmOperatorDirNone,        0,      "(",   NULL,  "(<expr>",          "Begin expression or function."),
+                      99, enmOperatorDirNone,        0,      0,                           "(",   NULL,                 NULL,                 NULL,               NULL,               NULL,               "(<expr>",          "Begin expression or function."),
     XOperator(XANK_CLOSE_PARENTHESIS_OPERATOR_ID,
-                      99,  enmOperatorDirNone,       0,      ")",   NULL,  "<expr>)",          "End expression or function."),
+                      99,  enmOperatorDirNone,       0,      0,                           ")",   NULL,                 NULL,                 NULL,               NULL,               NULL,               "<expr>)",          "End expression or function."),
     XOperator(XANK_PARAM_SEPARATOR_OPERATOR_ID,
-                       0,  enmOperatorDirLeft,       2,      ",",   NULL,  "<expr>, <expr>",   "Function parameter separator."),
+                       0,  enmOperatorDirLeft,       2,      0,                           ",",   NULL,                 NULL,                 NULL,               NULL,               NULL,               "<expr>, <expr>",   "Function parameter separator."),
     XOperator(XANK_ASSIGNMENT_OPERATOR_ID,
-                       0,  enmOperatorDirLeft,       2,      "=",   NULL,  "<lval>=<rval>",    "Assignment operator."),
+                       0,  enmOperatorDirLeft,       2,      0,                           "=",   NULL,                 NULL,                 NULL,               NULL,               NULL,               "<lval>=<rval>",    "Assignment operator."),
 
     /* Generic Operators */
-    XOperator(10,     70,  enmOperatorDirLeft,       2,      "+",  OpAdd, "<expr1> + <expr2>", "Addition operator.")
+    XOperator(XANK_ADD_OPERATOR_ID,
+                      70,  enmOperatorDirLeft,       2,      XANK_OPERATOR_F_ASSOCIATIVE, "+",   XAddKernels::Generic, XAddKernels::Integer, XAddKernels::Float, XAddKernels::Fixed, XAddKernels::Double, "<expr1> + <expr2>", "Addition operator.")
 };
 
 const size_t XEvaluator::m_cOperators = XANK_ARRAY_ELEMENTS(m_sOperators);
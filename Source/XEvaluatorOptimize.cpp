@@ -0,0 +1,1033 @@
+/** @file
+ * xank - Evaluator optimizations, implementation.
+ */
+
+/*
+ * Copyright (C) 2012 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "XEvaluator.h"
+#include "XAtom.h"
+#include "XErrors.h"
+#include "XGenericDefs.h"
+#include "XOperator.h"
+#include "XProgram.h"
+#include "ConsoleIO.h"
+#include "Debug.h"
+#include "Assert.h"
+
+#include <cfloat>
+#include <cmath>
+#include <map>
+
+/**
+ * Computes the maximum operand stack depth of a valid sequence of Instructions.
+ *
+ * @param Instructions      The Instructions.
+ *
+ * @return size_t: The maximum depth.
+ */
+static size_t InstructionsMaxDepth(const std::vector<XInstruction> &Instructions)
+{
+    size_t cDepth    = 0;
+    size_t cMaxDepth = 0;
+    for (size_t i = 0; i < Instructions.size(); i++)
+    {
+        const XInstruction *pcInstr = &Instructions[i];
+        if (   pcInstr->enmOp == enmInstructionOpPushConstant
+            || pcInstr->enmOp == enmInstructionOpPushConstantOperator
+            || pcInstr->enmOp == enmInstructionOpLoad)
+            ++cDepth;
+        else if (   pcInstr->enmOp == enmInstructionOpStore
+                 || pcInstr->enmOp == enmInstructionOpToFloat)
+            Assert(cDepth > 0);
+        else
+        {
+            Assert(cDepth >= pcInstr->cParams);
+            cDepth = cDepth - pcInstr->cParams + 1;
+        }
+        cMaxDepth = XANK_MAX(cMaxDepth, cDepth);
+    }
+    return cMaxDepth;
+}
+
+
+int XEvaluator::NarrowIntegers(XProgram *pProgram)
+{
+    /*
+     * Every constant is a literal at this point, each is converted on its own. Float literals
+     * have no fixed-width value. Function results could be anything, they're not supported.
+     */
+    const XFixedWidth *pcWidth = &pProgram->m_FixedWidth;
+    for (size_t i = 0; i < pProgram->m_Constants.size(); i++)
+    {
+        int rc = pcWidth->Narrow(&pProgram->m_Constants[i]);
+        if (IS_FAILURE(rc))
+            return rc;
+    }
+
+    for (size_t i = 0; i < pProgram->m_Instructions.size(); i++)
+    {
+        XInstruction *pInstr = &pProgram->m_Instructions[i];
+        if (pInstr->enmOp == enmInstructionOpFunction)
+            return ERR_NOT_SUPPORTED;
+        if (pInstr->enmOp == enmInstructionOpOperator)
+        {
+            if (!pInstr->u.pcOperator->FixedFunction())
+                return ERR_NOT_SUPPORTED;
+            pInstr->enmOp = enmInstructionOpOperatorFixed;
+        }
+    }
+    DEBUGPRINTF(("Narrowed integers to %s.\n", pcWidth->Name().c_str()));
+    return INF_SUCCESS;
+}
+
+
+int XEvaluator::FoldConstants(XProgram *pProgram)
+{
+    /*
+     * Re-emit the Program, tracking for each operand stack entry whether it's a constant.
+     * An Operator whose operands are all constants is invoked right away. Its operands are
+     * then necessarily the last Instructions emitted, all pushes, so they're replaced by a
+     * single push of the result. Constants are moved into a new pool as they're emitted,
+     * which also drops the ones that were folded away.
+     */
+    std::vector<XInstruction> Instructions;
+    std::vector<XAtom> Constants;
+    std::vector<bool> afConstant;
+    Instructions.reserve(pProgram->m_Instructions.size());
+    Constants.reserve(pProgram->m_Constants.size());     /* Never reallocated, we hold pointers into it. */
+
+    size_t cFolded = 0;
+    for (size_t i = 0; i < pProgram->m_Instructions.size(); i++)
+    {
+        XInstruction Instr = pProgram->m_Instructions[i];
+        if (Instr.enmOp == enmInstructionOpPushConstant)
+        {
+            Constants.push_back(XAtom());
+            Constants.back().Swap(pProgram->m_Constants[Instr.u.idxConstant]);
+            Instr.u.idxConstant = Constants.size() - 1;
+            Instructions.push_back(Instr);
+            afConstant.push_back(true);
+            continue;
+        }
+        else if (   Instr.enmOp == enmInstructionOpStore
+                 || Instr.enmOp == enmInstructionOpLoad)
+        {
+            Instructions.push_back(Instr);
+            if (Instr.enmOp == enmInstructionOpLoad)
+                afConstant.push_back(false);
+            continue;
+        }
+
+        const size_t cParams = Instr.cParams;
+        Assert(afConstant.size() >= cParams);
+        PFNOPERATOR pfnOperator = NULL;
+        void *pvData            = &m_ScratchPool;
+        if (Instr.enmOp == enmInstructionOpOperator)
+            pfnOperator = Instr.u.pcOperator->Function();
+        else if (Instr.enmOp == enmInstructionOpOperatorFixed)
+        {
+            pfnOperator = Instr.u.pcOperator->FixedFunction();
+            pvData      = &pProgram->m_FixedWidth;
+        }
+        bool fFoldable =    pfnOperator
+                         && cParams > 0;
+        for (size_t k = afConstant.size() - cParams; fFoldable && k < afConstant.size(); k++)
+            fFoldable = afConstant[k];
+
+        if (fFoldable)
+        {
+            Assert(Constants.size() >= cParams);
+            const size_t idxFirst = Constants.size() - cParams;
+            std::vector<XAtom*> apAtoms(cParams);
+            for (size_t k = 0; k < cParams; k++)
+                apAtoms[k] = &Constants[idxFirst + k];
+
+            /* Leave it to Evaluate() to report failures, keep the operand the result goes into intact. */
+            XAtom Saved(Constants[idxFirst]);
+            m_ScratchPool.SetFloatPrecision(Instr.cFloatBits);
+            int rc = pfnOperator(&apAtoms[0], cParams, pvData);
+            if (IS_SUCCESS(rc))
+            {
+                DEBUGPRINTF(("Folded operator '%s' into %s\n", Instr.u.pcOperator->Name().c_str(),
+                             Constants[idxFirst].PrintToString().c_str()));
+                Constants.resize(idxFirst + 1);
+                Instructions.resize(Instructions.size() - cParams + 1);
+                afConstant.resize(afConstant.size() - cParams + 1);
+                Assert(Instructions.back().u.idxConstant == idxFirst);
+                ++cFolded;
+                continue;
+            }
+            Constants[idxFirst].Swap(Saved);
+        }
+
+        Instructions.push_back(Instr);
+        afConstant.resize(afConstant.size() - cParams);
+        afConstant.push_back(false);
+    }
+
+    pProgram->m_Instructions.swap(Instructions);
+    pProgram->m_Constants.swap(Constants);
+    pProgram->m_cMaxDepth = InstructionsMaxDepth(pProgram->m_Instructions);
+    DEBUGPRINTF(("Folded %" FMT_SZT " operators.\n", cFolded));
+    return INF_SUCCESS;
+}
+
+
+
+/**
+ * Orders constants by type and value, for looking up identical constants.
+ */
+typedef struct XConstantLess
+{
+    static int Rank(const XAtom *pcAtom)
+    {
+        if (pcAtom->IsSmallInteger())
+            return 0;
+        if (pcAtom->IsInteger())
+            return 1;
+        if (pcAtom->IsFloat())
+            return 2;
+        return 3;
+    }
+
+    bool operator()(const XAtom *pcLeft, const XAtom *pcRight) const
+    {
+        const int iLeftRank  = Rank(pcLeft);
+        const int iRightRank = Rank(pcRight);
+        if (iLeftRank != iRightRank)
+            return iLeftRank < iRightRank;
+
+        switch (iLeftRank)
+        {
+            case 0: return pcLeft->SmallInteger() < pcRight->SmallInteger();
+            case 1: return mpz_cmp(pcLeft->BigInteger(), pcRight->BigInteger()) < 0;
+            case 2:
+            {
+                /* Different precisions are different values, they round differently. */
+                const mp_bitcnt_t cLeftBits  = mpf_get_prec(pcLeft->Float());
+                const mp_bitcnt_t cRightBits = mpf_get_prec(pcRight->Float());
+                if (cLeftBits != cRightBits)
+                    return cLeftBits < cRightBits;
+                return mpf_cmp(pcLeft->Float(), pcRight->Float()) < 0;
+            }
+            default: return pcLeft < pcRight;    /* Not a number, never shared. */
+        }
+    }
+} XConstantLess;
+
+/**
+ * The structure of an Operator or Function node: what is invoked, the precision it
+ * promotes with, and the value numbers of its operands.
+ */
+typedef struct XNodeKey
+{
+    XInstructionOp          enmOp;
+    const void             *pvFunctor;
+    uint32_t                cFloatBits;
+    std::vector<size_t>     avnOperands;
+
+    bool operator<(const XNodeKey &Other) const
+    {
+        if (enmOp != Other.enmOp)
+            return enmOp < Other.enmOp;
+        if (pvFunctor != Other.pvFunctor)
+            return pvFunctor < Other.pvFunctor;
+        if (cFloatBits != Other.cFloatBits)
+            return cFloatBits < Other.cFloatBits;
+        return avnOperands < Other.avnOperands;
+    }
+} XNodeKey;
+
+
+int XEvaluator::EliminateCommonSubexpressions(XProgram *pProgram)
+{
+    const std::vector<XInstruction> &Instructions = pProgram->m_Instructions;
+    std::vector<XAtom> &Constants = pProgram->m_Constants;
+
+    /*
+     * Hash-cons the expression tree into a DAG by numbering values: identical constants, and
+     * Operators or Functions invoked on operands with identical value numbers, get the same
+     * value number. Count how often each value is computed.
+     */
+    std::map<const XAtom*, size_t, XConstantLess> ConstantValues;
+    std::map<XNodeKey, size_t> NodeValues;
+    std::vector<size_t> avnInstructions(Instructions.size());
+    std::vector<size_t> acComputed;
+    std::vector<size_t> avnStack;
+    for (size_t i = 0; i < Instructions.size(); i++)
+    {
+        const XInstruction *pcInstr = &Instructions[i];
+        size_t vn = acComputed.size();
+        if (pcInstr->enmOp == enmInstructionOpPushConstant)
+        {
+            const XAtom *pcConstant = &Constants[pcInstr->u.idxConstant];
+            std::pair<std::map<const XAtom*, size_t, XConstantLess>::iterator, bool> Res
+                = ConstantValues.insert(std::make_pair(pcConstant, vn));
+            vn = Res.first->second;
+        }
+        else
+        {
+            AssertReturn(   pcInstr->enmOp == enmInstructionOpOperator
+                         || pcInstr->enmOp == enmInstructionOpOperatorFixed
+                         || pcInstr->enmOp == enmInstructionOpFunction, ERR_INVALID_RPN);
+            Assert(avnStack.size() >= pcInstr->cParams);
+            XNodeKey Key;
+            Key.enmOp      = pcInstr->enmOp;
+            Key.pvFunctor  = pcInstr->enmOp != enmInstructionOpFunction ? (const void *)pcInstr->u.pcOperator
+                                                                        : (const void *)pcInstr->u.pcFunction;
+            Key.cFloatBits = pcInstr->cFloatBits;
+            Key.avnOperands.assign(avnStack.end() - pcInstr->cParams, avnStack.end());
+            avnStack.resize(avnStack.size() - pcInstr->cParams);
+
+            std::pair<std::map<XNodeKey, size_t>::iterator, bool> Res = NodeValues.insert(std::make_pair(Key, vn));
+            vn = Res.first->second;
+        }
+
+        if (vn == acComputed.size())
+            acComputed.push_back(0);
+        ++acComputed[vn];
+        avnInstructions[i] = vn;
+        avnStack.push_back(vn);
+    }
+
+    /*
+     * Re-emit the Program. The first computation of a repeated value is followed by a Store,
+     * later ones are dropped along with their operands in favour of a Load. Operands of a
+     * repeat are never needed elsewhere, their first computations all precede it.
+     */
+    std::vector<XInstruction> Emitted;
+    std::vector<size_t> aidxStarts;     /* Where the Instructions computing each stack entry start. */
+    std::vector<size_t> aidxTemps(acComputed.size(), SIZE_MAX);
+    std::vector<size_t> acLoads;
+    Emitted.reserve(Instructions.size());
+
+    size_t cEliminated = 0;
+    for (size_t i = 0; i < Instructions.size(); i++)
+    {
+        const XInstruction *pcInstr = &Instructions[i];
+        const size_t vn             = avnInstructions[i];
+        const bool fPush            = pcInstr->enmOp == enmInstructionOpPushConstant;
+        const size_t cParams        = fPush ? 0 : pcInstr->cParams;
+        const size_t idxStart       = cParams ? aidxStarts[aidxStarts.size() - cParams] : Emitted.size();
+        aidxStarts.resize(aidxStarts.size() - cParams);
+        aidxStarts.push_back(idxStart);
+
+        if (   fPush
+            || acComputed[vn] < 2)
+        {
+            Emitted.push_back(*pcInstr);
+            continue;
+        }
+
+        XInstruction Instr;
+        Instr.cParams    = 0;
+        Instr.cFloatBits = 0;
+        if (aidxTemps[vn] == SIZE_MAX)
+        {
+            Emitted.push_back(*pcInstr);
+            aidxTemps[vn] = acLoads.size();
+            acLoads.push_back(0);
+            Instr.enmOp = enmInstructionOpStore;
+        }
+        else
+        {
+            for (size_t k = idxStart; k < Emitted.size(); k++)
+            {
+                if (Emitted[k].enmOp == enmInstructionOpLoad)
+                    --acLoads[Emitted[k].u.idxTemp];
+            }
+            Emitted.resize(idxStart);
+            ++acLoads[aidxTemps[vn]];
+            ++cEliminated;
+            Instr.enmOp = enmInstructionOpLoad;
+        }
+        Instr.u.idxTemp = aidxTemps[vn];
+        Emitted.push_back(Instr);
+    }
+
+    if (!cEliminated)
+        return INF_SUCCESS;
+
+    /*
+     * A value computed repeatedly only within a repeated parent is never loaded, drop its
+     * Store. Renumber the temporaries that remain, and drop the constants no longer pushed.
+     */
+    std::vector<size_t> aidxNewTemps(acLoads.size(), SIZE_MAX);
+    std::vector<size_t> aidxNewConstants(Constants.size(), SIZE_MAX);
+    std::vector<XAtom> NewConstants;
+    size_t cTemps = 0;
+    size_t cKept  = 0;
+    for (size_t i = 0; i < Emitted.size(); i++)
+    {
+        XInstruction Instr = Emitted[i];
+        if (   Instr.enmOp == enmInstructionOpStore
+            || Instr.enmOp == enmInstructionOpLoad)
+        {
+            if (!acLoads[Instr.u.idxTemp])
+                continue;
+            if (aidxNewTemps[Instr.u.idxTemp] == SIZE_MAX)
+                aidxNewTemps[Instr.u.idxTemp] = cTemps++;
+            Instr.u.idxTemp = aidxNewTemps[Instr.u.idxTemp];
+        }
+        else if (Instr.enmOp == enmInstructionOpPushConstant)
+        {
+            if (aidxNewConstants[Instr.u.idxConstant] == SIZE_MAX)
+            {
+                aidxNewConstants[Instr.u.idxConstant] = NewConstants.size();
+                NewConstants.push_back(XAtom());
+                NewConstants.back().Swap(Constants[Instr.u.idxConstant]);
+            }
+            Instr.u.idxConstant = aidxNewConstants[Instr.u.idxConstant];
+        }
+        Emitted[cKept++] = Instr;
+    }
+    Emitted.resize(cKept);
+
+    pProgram->m_Instructions.swap(Emitted);
+    pProgram->m_Constants.swap(NewConstants);
+    pProgram->m_cTemps    = cTemps;
+    pProgram->m_cMaxDepth = InstructionsMaxDepth(pProgram->m_Instructions);
+    DEBUGPRINTF(("Eliminated %" FMT_SZT " common subexpressions into %" FMT_SZT " temporaries.\n",
+                 cEliminated, cTemps));
+    return INF_SUCCESS;
+}
+
+
+int XEvaluator::FuseOperators(XProgram *pProgram)
+{
+    /*
+     * Track the Instruction that produced each operand stack entry. When an operand of an
+     * associative Operator was produced by the same Operator, that producer is dropped and
+     * its operands, which are still in place on the stack, become operands of the consumer.
+     * Operand order is kept and the n-ary Operator evaluates left to right, so fusing the
+     * producer of the first operand, a left-nested chain like a + b + c + d, gives the same
+     * result. Fusing other operands reassociates, e.g. a + (b + c), which only integer and
+     * fixed-width arithmetic is exact under, save signed saturating arithmetic. Since the
+     * consumer is updated in place before it's looked at as a producer, whole chains
+     * collapse into their last Instruction.
+     */
+    std::vector<XInstruction> &Instructions = pProgram->m_Instructions;
+    std::vector<size_t> aidxProducers;
+    std::vector<bool> afFused(Instructions.size(), false);
+
+    size_t cFused = 0;
+    for (size_t i = 0; i < Instructions.size(); i++)
+    {
+        XInstruction *pInstr = &Instructions[i];
+        if (   pInstr->enmOp == enmInstructionOpPushConstant
+            || pInstr->enmOp == enmInstructionOpLoad)
+        {
+            aidxProducers.push_back(i);
+            continue;
+        }
+        else if (pInstr->enmOp == enmInstructionOpStore)
+        {
+            /* The stored value is needed as is, never fuse its producer away. */
+            Assert(!aidxProducers.empty());
+            aidxProducers.back() = i;
+            continue;
+        }
+        else if (pInstr->enmOp == enmInstructionOpToFloat)
+        {
+            /* Likewise for a promoted value, it's not the result of its producer anymore. */
+            Assert(pInstr->u.offStack < aidxProducers.size());
+            aidxProducers[aidxProducers.size() - 1 - pInstr->u.offStack] = i;
+            continue;
+        }
+
+        const size_t cParams = pInstr->cParams;
+        Assert(aidxProducers.size() >= cParams);
+        const size_t idxFirst = aidxProducers.size() - cParams;
+        if (   pInstr->enmOp != enmInstructionOpFunction
+            && pInstr->u.pcOperator->IsAssociative())
+        {
+            /* Only with Instructions of the same type, and the same planned precision. */
+            const XFixedWidth &FixedWidth = pProgram->m_FixedWidth;
+            const bool fReassociate =    pInstr->enmOp == enmInstructionOpOperatorInteger
+                                      || (   pInstr->enmOp == enmInstructionOpOperatorFixed
+                                          && !(FixedWidth.IsSigned() && FixedWidth.IsSaturating()));
+            const size_t idxEnd = fReassociate ? aidxProducers.size() : idxFirst + 1;
+            uint64_t cOperands = cParams;
+            for (size_t k = idxFirst; k < idxEnd; k++)
+            {
+                const XInstruction *pcProducer = &Instructions[aidxProducers[k]];
+                if (   pcProducer->enmOp == pInstr->enmOp
+                    && pcProducer->u.pcOperator == pInstr->u.pcOperator
+                    && pcProducer->cFloatBits == pInstr->cFloatBits
+                    && cOperands + pcProducer->cParams - 1 <= UINT32_MAX)
+                {
+                    cOperands += pcProducer->cParams - 1;
+                    afFused[aidxProducers[k]] = true;
+                    ++cFused;
+                }
+            }
+            pInstr->cParams = (uint32_t)cOperands;
+        }
+
+        aidxProducers.resize(idxFirst);
+        aidxProducers.push_back(i);
+    }
+
+    if (cFused)
+    {
+        size_t cKept = 0;
+        for (size_t i = 0; i < Instructions.size(); i++)
+        {
+            if (!afFused[i])
+                Instructions[cKept++] = Instructions[i];
+        }
+        Instructions.resize(cKept);
+        pProgram->m_cMaxDepth = InstructionsMaxDepth(Instructions);
+    }
+    DEBUGPRINTF(("Fused %" FMT_SZT " operators.\n", cFused));
+    return INF_SUCCESS;
+}
+
+
+/** Sign of an operand stack entry that is not known when compiling. */
+#define XANK_SIGN_UNKNOWN       2
+
+/**
+ * An operand stack entry while planning precisions.
+ */
+typedef struct XPrecisionEntry
+{
+    /** Index of the Instruction that produced it. */
+    size_t                  idxProducer;
+    /** Index of the Instruction whose value it was computed in, see PlanPrecisions(). */
+    size_t                  idxRoot;
+    /** The sign, -1, 0 or 1, XANK_SIGN_UNKNOWN if not known. */
+    int                     iSign;
+} XPrecisionEntry;
+
+/**
+ * Returns the sign of a constant.
+ *
+ * @param pcAtom            The constant.
+ *
+ * @return int: -1, 0 or 1, XANK_SIGN_UNKNOWN if it's not a number.
+ */
+static int ConstantSign(const XAtom *pcAtom)
+{
+    if (pcAtom->IsSmallInteger())
+        return (pcAtom->SmallInteger() > 0) - (pcAtom->SmallInteger() < 0);
+    if (pcAtom->IsInteger())
+        return mpz_sgn(pcAtom->BigInteger());
+    if (pcAtom->IsFloat())
+        return mpf_sgn(pcAtom->Float());
+    return XANK_SIGN_UNKNOWN;
+}
+
+
+int XEvaluator::PlanPrecisions(XProgram *pProgram)
+{
+    /*
+     * Operators accumulate into their first operand, whose precision was taken from the
+     * constant it was copied from, or is the one it was promoted with. So the value of every
+     * operand stack entry is computed in the storage of its root: the constant or Function
+     * result at the start of its chain of first operands.
+     *
+     * Walk forward to find the operands, the root and the sign of every entry. A sum of
+     * operands of the same sign can't cancel, every other operation is assumed to.
+     */
+    std::vector<XInstruction> &Instructions = pProgram->m_Instructions;
+    const size_t cInstrs = Instructions.size();
+    std::vector<XPrecisionEntry> Entries;
+    std::vector<size_t> aidxRoots(cInstrs, SIZE_MAX);
+    std::vector<size_t> aidxOperands;                   /* Producers of the operands, see aoffOperands. */
+    std::vector<size_t> aoffOperands(cInstrs, 0);
+    std::vector<bool> afCancels(cInstrs, false);
+    for (size_t i = 0; i < cInstrs; i++)
+    {
+        const XInstruction *pcInstr = &Instructions[i];
+        switch (pcInstr->enmOp)
+        {
+            case enmInstructionOpPushConstant:
+            {
+                const XPrecisionEntry Entry = { i, i, ConstantSign(&pProgram->m_Constants[pcInstr->u.idxConstant]) };
+                Entries.push_back(Entry);
+                aidxRoots[i] = i;
+                break;
+            }
+
+            case enmInstructionOpOperator:
+            case enmInstructionOpFunction:
+            {
+                const size_t cParams = pcInstr->cParams;
+                AssertReturn(cParams > 0 && Entries.size() >= cParams, ERR_INVALID_RPN);
+                const size_t idxFirst = Entries.size() - cParams;
+
+                int iSign = Entries[idxFirst].iSign;
+                aoffOperands[i] = aidxOperands.size();
+                for (size_t k = idxFirst; k < Entries.size(); k++)
+                {
+                    aidxOperands.push_back(Entries[k].idxProducer);
+                    if (   !iSign
+                        || iSign == XANK_SIGN_UNKNOWN)
+                        iSign = Entries[k].iSign;
+                    else if (   Entries[k].iSign
+                             && Entries[k].iSign != iSign)
+                        iSign = XANK_SIGN_UNKNOWN;
+                }
+
+                XPrecisionEntry Entry = { i, i, XANK_SIGN_UNKNOWN };
+                if (pcInstr->enmOp == enmInstructionOpOperator)
+                {
+                    Entry.idxRoot = Entries[idxFirst].idxRoot;
+                    if (   pcInstr->u.pcOperator->Id() == XANK_ADD_OPERATOR_ID
+                        && iSign != XANK_SIGN_UNKNOWN)
+                        Entry.iSign = iSign;
+                    else
+                        afCancels[i] = true;
+                }
+                Entries.resize(idxFirst);
+                Entries.push_back(Entry);
+                aidxRoots[i] = Entry.idxRoot;
+                break;
+            }
+
+            default:
+                /* Only the Instructions as compiled, see Optimize(). */
+                DEBUGPRINTF(("Unexpected Instruction %d when planning precisions.\n", pcInstr->enmOp));
+                return ERR_INVALID_RPN;
+        }
+    }
+
+    /*
+     * Walk backward from the results, which need the Program's precision, to find the bits
+     * every value needs and the bits every root must store to compute the values in it.
+     * Summing n operands rounds up to n-1 times, each operand is off by half an ulp and
+     * cancellation loses up to the guard bits. Consumers come after producers, so each is
+     * final when it is reached.
+     *
+     * Integers are promoted with the precision of the Instruction doing it: an Operator
+     * promotes its first operand, the root, and the others in scratch registers, so it uses
+     * the precision of the root.
+     */
+    std::vector<mp_bitcnt_t> acNeeded(cInstrs, 0);
+    std::vector<mp_bitcnt_t> acStored(cInstrs, 0);
+    for (size_t i = 0; i < Entries.size(); i++)
+        acNeeded[Entries[i].idxProducer] = XANK_MAX(acNeeded[Entries[i].idxProducer], pProgram->m_cFloatBits);
+
+    for (size_t i = cInstrs; i-- > 0;)
+    {
+        const XInstruction *pcInstr = &Instructions[i];
+        if (pcInstr->enmOp == enmInstructionOpPushConstant)
+            continue;
+
+        mp_bitcnt_t cBits = acNeeded[i] + 1;
+        for (uint32_t cLeft = pcInstr->cParams - 1; cLeft; cLeft >>= 1)
+            ++cBits;
+        if (afCancels[i])
+            cBits += XANK_FLOAT_GUARD_BITS;
+        if (pcInstr->enmOp == enmInstructionOpOperator)
+            acStored[aidxRoots[i]] = XANK_MAX(acStored[aidxRoots[i]], cBits);
+        else
+            Instructions[i].cFloatBits = (uint32_t)XANK_MAX(cBits, acStored[i]);
+        for (uint32_t k = 0; k < pcInstr->cParams; k++)
+        {
+            const size_t idxOperand = aidxOperands[aoffOperands[i] + k];
+            acNeeded[idxOperand] = XANK_MAX(acNeeded[idxOperand], cBits);
+        }
+    }
+
+    /* The Operators closer to the root need more, so the whole chain promotes with what it stores. */
+    for (size_t i = 0; i < cInstrs; i++)
+    {
+        if (Instructions[i].enmOp == enmInstructionOpOperator)
+            Instructions[i].cFloatBits = (uint32_t)acStored[aidxRoots[i]];
+    }
+
+    /*
+     * Set the precision of the float constants. A constant pushed more than once gets the
+     * most any of its pushes needs.
+     */
+    std::vector<mp_bitcnt_t> acConstantBits(pProgram->m_Constants.size(), 0);
+    for (size_t i = 0; i < cInstrs; i++)
+    {
+        if (Instructions[i].enmOp == enmInstructionOpPushConstant)
+        {
+            const size_t idxConstant = Instructions[i].u.idxConstant;
+            acConstantBits[idxConstant] = XANK_MAX(acConstantBits[idxConstant], XANK_MAX(acNeeded[i], acStored[i]));
+        }
+    }
+
+    size_t cPlanned = 0;
+    for (size_t i = 0; i < acConstantBits.size(); i++)
+    {
+        XAtom *pConstant = &pProgram->m_Constants[i];
+        if (   acConstantBits[i]
+            && pConstant->IsFloat())
+        {
+            mpf_set_prec(pConstant->MutableFloat(0), acConstantBits[i]);
+            ++cPlanned;
+        }
+    }
+    DEBUGPRINTF(("Planned the precision of %" FMT_SZT " float constants.\n", cPlanned));
+    return INF_SUCCESS;
+}
+
+
+/**
+ * Operand types known when compiling.
+ */
+typedef enum XStaticType
+{
+    enmStaticTypeUnknown = 0x60,
+    enmStaticTypeInteger,
+    enmStaticTypeFloat
+} XStaticType;
+
+/**
+ * An operand stack entry while inferring types.
+ */
+typedef struct XTypedEntry
+{
+    /** The type of the operand. */
+    XStaticType             enmType;
+    /** Index of the Instruction pushing it if it's a constant pushed as is, SIZE_MAX otherwise. */
+    size_t                  idxPush;
+} XTypedEntry;
+
+
+int XEvaluator::SpecializeTypes(XProgram *pProgram)
+{
+    /*
+     * Constants are typed when parsed. Integer operations give integers and float operations
+     * floats, the rest is not known until evaluated, e.g. Function results. An Operator whose
+     * operands are all integers invokes its integer function. If they are all numbers and at
+     * least one is a float, the integers are promoted and it invokes its float function, like
+     * the generic function would. Every PushConstant has a constant of its own, so constants
+     * are promoted in the pool. Other operands get a ToFloat Instruction right before the
+     * Operator.
+     */
+    std::vector<XInstruction> Instructions;
+    std::vector<XTypedEntry> Entries;
+    std::vector<XStaticType> aTempTypes(pProgram->m_cTemps, enmStaticTypeUnknown);
+    Instructions.reserve(pProgram->m_Instructions.size());
+
+    size_t cSpecialized = 0;
+    for (size_t i = 0; i < pProgram->m_Instructions.size(); i++)
+    {
+        XInstruction Instr = pProgram->m_Instructions[i];
+        XTypedEntry Entry;
+        Entry.enmType = enmStaticTypeUnknown;
+        Entry.idxPush = SIZE_MAX;
+        switch (Instr.enmOp)
+        {
+            case enmInstructionOpPushConstant:
+            {
+                const XAtom *pcConstant = &pProgram->m_Constants[Instr.u.idxConstant];
+                if (pcConstant->IsInteger())
+                    Entry.enmType = enmStaticTypeInteger;
+                else if (pcConstant->IsFloat())
+                    Entry.enmType = enmStaticTypeFloat;
+                Entry.idxPush = Instructions.size();
+                break;
+            }
+
+            case enmInstructionOpLoad:
+                Entry.enmType = aTempTypes[Instr.u.idxTemp];
+                break;
+
+            case enmInstructionOpStore:
+            {
+                /* The stored value is taken as is, it must not be promoted in the pool afterwards. */
+                AssertReturn(!Entries.empty(), ERR_INVALID_RPN);
+                aTempTypes[Instr.u.idxTemp] = Entries.back().enmType;
+                Entries.back().idxPush = SIZE_MAX;
+                Instructions.push_back(Instr);
+                continue;
+            }
+
+            case enmInstructionOpFunction:
+                AssertReturn(Entries.size() >= Instr.cParams, ERR_INVALID_RPN);
+                Entries.resize(Entries.size() - Instr.cParams);
+                break;
+
+            case enmInstructionOpOperatorFixed:
+                /* Already specialised, see NarrowIntegers(). */
+                AssertReturn(Entries.size() >= Instr.cParams, ERR_INVALID_RPN);
+                Entries.resize(Entries.size() - Instr.cParams);
+                Entry.enmType = enmStaticTypeInteger;
+                break;
+
+            case enmInstructionOpOperator:
+            {
+                AssertReturn(Entries.size() >= Instr.cParams, ERR_INVALID_RPN);
+                const size_t idxFirst       = Entries.size() - Instr.cParams;
+                const XOperator *pcOperator = Instr.u.pcOperator;
+                size_t cIntegers = 0;
+                size_t cFloats   = 0;
+                for (size_t k = idxFirst; k < Entries.size(); k++)
+                {
+                    if (Entries[k].enmType == enmStaticTypeInteger)
+                        ++cIntegers;
+                    else if (Entries[k].enmType == enmStaticTypeFloat)
+                        ++cFloats;
+                }
+
+                if (   pcOperator->IntegerFunction()
+                    && cIntegers == Instr.cParams)
+                {
+                    Instr.enmOp   = enmInstructionOpOperatorInteger;
+                    Entry.enmType = enmStaticTypeInteger;
+                    ++cSpecialized;
+                }
+                else if (   pcOperator->FloatFunction()
+                         && cFloats > 0
+                         && cIntegers + cFloats == Instr.cParams)
+                {
+                    for (size_t k = idxFirst; k < Entries.size(); k++)
+                    {
+                        if (Entries[k].enmType != enmStaticTypeInteger)
+                            continue;
+                        if (Entries[k].idxPush != SIZE_MAX)
+                        {
+                            XAtom *pConstant = &pProgram->m_Constants[Instructions[Entries[k].idxPush].u.idxConstant];
+                            pConstant->MutableFloat(Instr.cFloatBits);
+                        }
+                        else
+                        {
+                            XInstruction Promote;
+                            Promote.enmOp      = enmInstructionOpToFloat;
+                            Promote.cParams    = 0;
+                            Promote.cFloatBits = Instr.cFloatBits;
+                            Promote.u.offStack = Entries.size() - 1 - k;
+                            Instructions.push_back(Promote);
+                        }
+                    }
+                    Instr.enmOp   = enmInstructionOpOperatorFloat;
+                    Entry.enmType = enmStaticTypeFloat;
+                    ++cSpecialized;
+                }
+                Entries.resize(idxFirst);
+                break;
+            }
+
+            default:
+                DEBUGPRINTF(("Unexpected Instruction %d when typing.\n", Instr.enmOp));
+                return ERR_INVALID_RPN;
+        }
+
+        Instructions.push_back(Instr);
+        Entries.push_back(Entry);
+    }
+
+    pProgram->m_Instructions.swap(Instructions);
+    DEBUGPRINTF(("Specialized %" FMT_SZT " operators.\n", cSpecialized));
+    return INF_SUCCESS;
+}
+
+
+int XEvaluator::FormSuperinstructions(XProgram *pProgram)
+{
+    /*
+     * A constant pushed right before an Operator is one of its operands, but never the first
+     * one unless the Operator takes a single operand. Those pushes become PushConstantOperator
+     * which also evaluates the Operator, passing it the constant in place. The Operator
+     * Instruction stays where it is, the superinstruction consumes it, so the stack depth and
+     * every other Instruction are unaffected.
+     */
+    std::vector<XInstruction> &Instructions = pProgram->m_Instructions;
+    size_t cFormed = 0;
+    for (size_t i = 0; i + 1 < Instructions.size(); i++)
+    {
+        const XInstruction *pcNext = &Instructions[i + 1];
+        if (   Instructions[i].enmOp == enmInstructionOpPushConstant
+            && (   pcNext->enmOp == enmInstructionOpOperator
+                || pcNext->enmOp == enmInstructionOpOperatorInteger
+                || pcNext->enmOp == enmInstructionOpOperatorFloat
+                || pcNext->enmOp == enmInstructionOpOperatorFixed)
+            && pcNext->cParams >= 2)
+        {
+            Instructions[i].enmOp = enmInstructionOpPushConstantOperator;
+            ++cFormed;
+            ++i;
+        }
+    }
+    DEBUGPRINTF(("Formed %" FMT_SZT " superinstructions.\n", cFormed));
+    return INF_SUCCESS;
+}
+
+
+int XEvaluator::AllocateRegisters(XProgram *pProgram)
+{
+    /*
+     * The operand stack entry at depth n lives in register n, so an Operator writes the
+     * register of its first operand, in place when that is an intermediate. Temporaries
+     * get registers above the stack's. Constants and temporaries are read where they are
+     * instead of being pushed, they're only copied when they're the first operand, which
+     * gets overwritten by the result.
+     */
+    const size_t cConstants = pProgram->m_Constants.size();
+    const size_t cRegisters = pProgram->m_cMaxDepth + pProgram->m_cTemps;
+    if (cConstants + cRegisters > UINT32_MAX)
+        return INF_SUCCESS;     /* Stay with the stack machine. */
+
+    std::vector<XRegInstruction> RegInstructions;
+    std::vector<uint32_t> RegOperands;
+    std::vector<uint32_t> aidxSlots;    /* The slot of each operand stack entry. */
+    size_t cMaxParams = 0;
+    for (size_t i = 0; i < pProgram->m_Instructions.size(); i++)
+    {
+        const XInstruction *pcInstr = &pProgram->m_Instructions[i];
+        const uint32_t idxStackReg  = (uint32_t)(cConstants + aidxSlots.size());
+        XRegInstruction RegInstr;
+        RegInstr.cParams      = 0;
+        RegInstr.idxOperands  = 0;
+        RegInstr.cFloatBits   = pcInstr->cFloatBits;
+        RegInstr.u.pcOperator = NULL;
+        switch (pcInstr->enmOp)
+        {
+            case enmInstructionOpPushConstant:
+            case enmInstructionOpPushConstantOperator:
+                aidxSlots.push_back((uint32_t)pcInstr->u.idxConstant);
+                continue;
+
+            case enmInstructionOpLoad:
+                aidxSlots.push_back((uint32_t)(cConstants + pProgram->m_cMaxDepth + pcInstr->u.idxTemp));
+                continue;
+
+            case enmInstructionOpStore:
+                AssertReturn(!aidxSlots.empty(), ERR_INVALID_RPN);
+                RegInstr.enmOp       = enmInstructionOpMove;
+                RegInstr.idxDst      = (uint32_t)(pProgram->m_cMaxDepth + pcInstr->u.idxTemp);
+                RegInstr.idxOperands = aidxSlots.back();
+                RegInstructions.push_back(RegInstr);
+                continue;
+
+            case enmInstructionOpToFloat:
+            {
+                AssertReturn(pcInstr->u.offStack < aidxSlots.size(), ERR_INVALID_RPN);
+                const size_t idxEntry = aidxSlots.size() - 1 - pcInstr->u.offStack;
+                const uint32_t idxReg = (uint32_t)(cConstants + idxEntry);
+                if (aidxSlots[idxEntry] != idxReg)
+                {
+                    /* Never promote a constant or temporary in place. */
+                    RegInstr.enmOp       = enmInstructionOpMove;
+                    RegInstr.idxDst      = (uint32_t)idxEntry;
+                    RegInstr.idxOperands = aidxSlots[idxEntry];
+                    RegInstructions.push_back(RegInstr);
+                    aidxSlots[idxEntry] = idxReg;
+                }
+                RegInstr.enmOp  = enmInstructionOpToFloat;
+                RegInstr.idxDst = (uint32_t)idxEntry;
+                RegInstructions.push_back(RegInstr);
+                continue;
+            }
+
+            case enmInstructionOpOperator:
+            case enmInstructionOpOperatorInteger:
+            case enmInstructionOpOperatorFloat:
+            case enmInstructionOpOperatorFixed:
+            case enmInstructionOpFunction:
+            {
+                const size_t cParams = pcInstr->cParams;
+                AssertReturn(aidxSlots.size() >= cParams, ERR_INVALID_RPN);
+                const size_t idxFirst = aidxSlots.size() - cParams;
+                RegInstr.enmOp        = pcInstr->enmOp;
+                RegInstr.cParams      = pcInstr->cParams;
+                RegInstr.idxDst       = (uint32_t)idxFirst;
+                RegInstr.idxOperands  = (uint32_t)RegOperands.size();
+                if (pcInstr->enmOp == enmInstructionOpFunction)
+                    RegInstr.u.pcFunction = pcInstr->u.pcFunction;
+                else
+                    RegInstr.u.pcOperator = pcInstr->u.pcOperator;
+                RegOperands.insert(RegOperands.end(), aidxSlots.begin() + idxFirst, aidxSlots.end());
+                RegInstructions.push_back(RegInstr);
+                cMaxParams = XANK_MAX(cMaxParams, cParams);
+
+                aidxSlots.resize(idxFirst);
+                aidxSlots.push_back(idxStackReg - (uint32_t)cParams);
+                continue;
+            }
+
+            default:
+                DEBUGPRINTF(("Unexpected Instruction %d when allocating registers.\n", pcInstr->enmOp));
+                return ERR_INVALID_RPN;
+        }
+    }
+
+    AssertReturn(RegOperands.size() <= UINT32_MAX, ERR_INVALID_RPN);
+    Assert(aidxSlots.size() == pProgram->m_cResults);
+    pProgram->m_RegInstructions.swap(RegInstructions);
+    pProgram->m_RegOperands.swap(RegOperands);
+    pProgram->m_RegResults.swap(aidxSlots);
+    pProgram->m_cRegisters = cRegisters;
+    pProgram->m_cMaxParams = cMaxParams;
+    pProgram->m_fRegisters = true;
+    return INF_SUCCESS;
+}
+
+
+void XEvaluator::PrepareDoubleTier(XProgram *pProgram, uint32_t cDigits)
+{
+    /*
+     * Doubles can't be accurate to much more than 15 digits. Only Programs whose constants
+     * are all floats qualify, then every value they compute is a float, unless they invoke
+     * a Function. Constants must be in the range of a double, mpf_get_d() truncates them
+     * so they're off by less than an ulp.
+     */
+    const double rTolerance = std::pow(10.0, -(double)cDigits);
+    if (rTolerance < 4 * DBL_EPSILON)
+        return;
+
+    std::vector<XBoundedDouble> Constants(pProgram->m_Constants.size());
+    for (size_t i = 0; i < pProgram->m_Constants.size(); i++)
+    {
+        const XAtom *pcConstant = &pProgram->m_Constants[i];
+        if (!pcConstant->IsFloat())
+            return;
+
+        signed long iExp;
+        mpf_get_d_2exp(&iExp, pcConstant->Float());
+        if (   iExp < DBL_MIN_EXP
+            || iExp > DBL_MAX_EXP)
+            return;
+        Constants[i].rValue = mpf_get_d(pcConstant->Float());
+        Constants[i].rError = std::fabs(Constants[i].rValue) * DBL_EPSILON;
+    }
+
+    for (size_t i = 0; i < pProgram->m_Instructions.size(); i++)
+    {
+        const XInstruction *pcInstr = &pProgram->m_Instructions[i];
+        switch (pcInstr->enmOp)
+        {
+            case enmInstructionOpPushConstant:
+            case enmInstructionOpPushConstantOperator:
+            case enmInstructionOpStore:
+            case enmInstructionOpLoad:
+                break;
+
+            case enmInstructionOpOperator:
+            case enmInstructionOpOperatorFloat:
+                if (!pcInstr->u.pcOperator->DoubleFunction())
+                    return;
+                break;
+
+            default:
+                return;
+        }
+    }
+
+    pProgram->m_DoubleConstants.swap(Constants);
+    pProgram->m_rDoubleTolerance = rTolerance;
+    pProgram->m_fDoubleTier      = true;
+}
+
@@ -0,0 +1,149 @@
+/** @file
+ * xank - Fixed-width integers, implementation.
+ */
+
+/*
+ * Copyright (C) 2012 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "XFixedWidth.h"
+#include "XAtom.h"
+#include "XErrors.h"
+#include "XGenericDefs.h"
+#include "Assert.h"
+
+#include <gmp.h>
+#include <sstream>
+
+XFixedWidth::XFixedWidth()
+    : m_cBits(0),
+    m_fSigned(false),
+    m_fSaturate(false)
+{
+}
+
+
+XFixedWidth::~XFixedWidth()
+{
+}
+
+
+int XFixedWidth::SetFromName(const std::string &sName, bool fSaturate)
+{
+    if (sName.empty())
+    {
+        m_cBits     = 0;
+        m_fSigned   = false;
+        m_fSaturate = false;
+        return INF_SUCCESS;
+    }
+
+    uint32_t cBits;
+    const std::string sBits = sName.substr(1);
+    if (sBits == "8")
+        cBits = 8;
+    else if (sBits == "16")
+        cBits = 16;
+    else if (sBits == "32")
+        cBits = 32;
+    else if (sBits == "64")
+        cBits = 64;
+    else
+        return ERR_INVALID_PARAMETER;
+
+    if (   sName[0] != 'u'
+        && sName[0] != 'i')
+        return ERR_INVALID_PARAMETER;
+
+    m_cBits     = cBits;
+    m_fSigned   = sName[0] == 'i';
+    m_fSaturate = fSaturate;
+    return INF_SUCCESS;
+}
+
+
+std::string XFixedWidth::Name() const
+{
+    if (!m_cBits)
+        return std::string();
+
+    std::ostringstream sOut;
+    sOut << (m_fSigned ? 'i' : 'u') << m_cBits;
+    return sOut.str();
+}
+
+
+int XFixedWidth::Narrow(XAtom *pAtom) const
+{
+    AssertReturn(m_cBits, ERR_INVALID_PARAMETER);
+    if (!pAtom->IsInteger())
+        return ERR_INVALID_ATOM_TYPE_FOR_OPERATION;
+
+    int64_t iValue;
+    if (pAtom->IsSmallInteger())
+    {
+        iValue = pAtom->SmallInteger();
+        if (!m_fSaturate)
+            iValue = Wrap((uint64_t)iValue);
+        else if (m_fSigned)
+            iValue = XANK_MIN(XANK_MAX(iValue, Min()), Max());
+        else if (iValue < 0)
+            iValue = 0;
+        else if ((uint64_t)iValue > UnsignedMax())
+            iValue = (int64_t)UnsignedMax();
+    }
+    else
+    {
+        /* Only literals get here, it's done once when compiling. */
+        mpz_srcptr pcValue = pAtom->BigInteger();
+        const int iSign    = mpz_sgn(pcValue);
+        if (   !m_fSaturate
+            || (   !m_fSigned
+                && m_cBits == 64
+                && iSign > 0
+                && mpz_sizeinbase(pcValue, 2) <= 64))
+        {
+            /* The low 64 bits of the two's complement value. */
+            mpz_t Low;
+            mpz_init(Low);
+            mpz_fdiv_r_2exp(Low, pcValue, 64);
+            uint64_t uBits = 0;
+            mpz_export(&uBits, NULL, -1, sizeof(uBits), 0, 0, Low);
+            mpz_clear(Low);
+            iValue = Wrap(uBits);
+        }
+        else if (iSign < 0)
+            iValue = m_fSigned ? Min() : 0;
+        else
+            iValue = m_fSigned ? Max() : (int64_t)UnsignedMax();
+    }
+    return pAtom->SetSmallInteger(iValue);
+}
+
+
+void XFixedWidth::Widen(XAtom *pAtom) const
+{
+    /* Only u64 has values that don't fit a small integer. */
+    if (   m_cBits == 64
+        && !m_fSigned
+        && pAtom->IsSmallInteger()
+        && pAtom->SmallInteger() < 0)
+    {
+        const uint64_t uBits = (uint64_t)pAtom->SmallInteger();
+        mpz_import(pAtom->MutableInteger(), 1, -1, sizeof(uBits), 0, 0, &uBits);
+    }
+}
+
@@ -0,0 +1,191 @@
+/** @file
+ * xank - Fixed-width integers, header.
+ */
+
+/*
+ * Copyright (C) 2012 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XANK_FIXED_WIDTH_H
+# define XANK_FIXED_WIDTH_H
+
+#include <stdint.h>
+
+#include <string>
+
+class XAtom;
+
+/**
+ * A fixed integer width.
+ * Integers of a Program compiled with a fixed width are machine words of that width,
+ * e.g. u8 or i64, which wrap around or saturate at the limits of the width instead of
+ * growing. They are held as small integer Atoms: signed values sign-extended, unsigned
+ * ones zero-extended, except that u64 keeps the bit pattern of values from 2^63 on
+ * until they are widened for the result.
+ */
+class XFixedWidth
+{
+    public:
+        XFixedWidth();
+        virtual ~XFixedWidth();
+
+        /**
+         * Sets the width from its name.
+         *
+         * @param sName             The name, u8, u16, u32, u64, i8, i16, i32 or i64, or an
+         *                          empty string for arbitrary precision integers.
+         * @param fSaturate         Whether results saturate instead of wrapping around.
+         *
+         * @return int: xank error code, ERR_INVALID_PARAMETER for an unknown name.
+         */
+        int                         SetFromName(const std::string &sName, bool fSaturate);
+
+        /**
+         * Returns the name of the width, empty for arbitrary precision integers.
+         *
+         * @return std::string
+         */
+        std::string                 Name() const;
+
+        /**
+         * Returns if integers have a fixed width.
+         *
+         * @return bool: true if fixed, false for arbitrary precision integers.
+         */
+        bool                        IsFixed() const;
+
+        /**
+         * Returns if integers are signed.
+         *
+         * @return bool: true if signed, false otherwise.
+         */
+        bool                        IsSigned() const;
+
+        /**
+         * Returns if results saturate at the limits of the width instead of wrapping
+         * around.
+         *
+         * @return bool: true if saturating, false otherwise.
+         */
+        bool                        IsSaturating() const;
+
+        /**
+         * Returns the smallest signed value.
+         *
+         * @return int64_t
+         */
+        int64_t                     Min() const;
+
+        /**
+         * Returns the largest signed value.
+         *
+         * @return int64_t
+         */
+        int64_t                     Max() const;
+
+        /**
+         * Returns the largest unsigned value.
+         *
+         * @return uint64_t
+         */
+        uint64_t                    UnsignedMax() const;
+
+        /**
+         * Wraps a 64-bit result around to the width.
+         *
+         * @param uBits             The result, modulo 2^64.
+         *
+         * @return int64_t: The value as held in a small integer Atom.
+         */
+        int64_t                     Wrap(uint64_t uBits) const;
+
+        /**
+         * Converts an Integer Atom of any size to the width, wrapping it around or
+         * saturating it.
+         *
+         * @param pAtom             The Atom.
+         *
+         * @return int: xank error code, ERR_INVALID_ATOM_TYPE_FOR_OPERATION if the Atom
+         *         is not an integer.
+         */
+        int                         Narrow(XAtom *pAtom) const;
+
+        /**
+         * Converts an Atom holding a value of the width to an Integer Atom of the
+         * same value.
+         *
+         * @param pAtom             The Atom.
+         */
+        void                        Widen(XAtom *pAtom) const;
+
+    private:
+        uint32_t                    m_cBits;        /**< Width in bits, 0 for arbitrary precision integers. */
+        bool                        m_fSigned;      /**< Whether integers are signed, two's complement. */
+        bool                        m_fSaturate;    /**< Whether results saturate instead of wrapping around. */
+};
+
+
+inline bool XFixedWidth::IsFixed() const
+{
+    return m_cBits != 0;
+}
+
+
+inline bool XFixedWidth::IsSigned() const
+{
+    return m_fSigned;
+}
+
+
+inline bool XFixedWidth::IsSaturating() const
+{
+    return m_fSaturate;
+}
+
+
+inline uint64_t XFixedWidth::UnsignedMax() const
+{
+    return m_cBits < 64 ? (UINT64_C(1) << m_cBits) - 1 : UINT64_MAX;
+}
+
+
+inline int64_t XFixedWidth::Max() const
+{
+    return (int64_t)(UnsignedMax() >> 1);
+}
+
+
+inline int64_t XFixedWidth::Min() const
+{
+    return -Max() - 1;
+}
+
+
+inline int64_t XFixedWidth::Wrap(uint64_t uBits) const
+{
+    if (m_cBits < 64)
+    {
+        const uint64_t fMask = UnsignedMax();
+        uBits &= fMask;
+        if (   m_fSigned
+            && (uBits >> (m_cBits - 1)))
+            uBits |= ~fMask;
+    }
+    return (int64_t)uBits;
+}
+
+#endif /* XANK_FIXED_WIDTH_H */
+
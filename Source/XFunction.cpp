@@ -43,7 +43,7 @@ XFunction::~XFunction()
 {
 }
 
-std::string XFunction::Name() const
+const std::string &XFunction::Name() const
 {
     return m_sName;
 }
@@ -121,9 +121,9 @@ int XFunction::SetFunction(PFNFUNCTION pfnFunction)
 }
 
 
-int XFunction::Invoke(XAtom *apAtoms[], uint64_t cAtoms) const
+int XFunction::Invoke(XAtom *apAtoms[], uint64_t cAtoms, void *pvData) const
 {
-    int rc = (*m_pfnFunction)(apAtoms, cAtoms);
+    int rc = (*m_pfnFunction)(apAtoms, cAtoms, pvData);
     return rc;
 }
 
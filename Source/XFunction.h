@@ -28,8 +28,12 @@
 
 class XAtom;
 
-/** A Function function. */
-typedef int FNFUNCTION(XAtom *apAtoms_[], uint64_t cAtoms_);
+/**
+ * A Function function.
+ * The result is written into the first parameter, apAtoms_[0]. pvData_ is the
+ * evaluator's XScratchPool for GMP temporaries.
+ */
+typedef int FNFUNCTION(XAtom *apAtoms_[], uint64_t cAtoms_, void *pvData_);
 /** Pointer to a Function function. */
 typedef FNFUNCTION *PFNFUNCTION;
 
@@ -66,11 +70,11 @@ class XFunction
         virtual ~XFunction();
 
         /**
-         * Returns a copy of the name of this Function.
+         * Returns the name of this Function.
          *
-         * @return std::string
+         * @return const std::string&
          */
-        std::string         Name() const;
+        const std::string  &Name() const;
 
         /**
          * Sets the name of this Function.
@@ -168,10 +172,11 @@ class XFunction
          *
          * @param apAtoms_          An array of pointers to Atoms.
          * @param cAtoms_           Number of elements in the array apAtoms_.
+         * @param pvData_           Private data, the evaluator's XScratchPool.
          *
          * @return int: xank error code..
          */
-        int                 Invoke(XAtom *apAtoms[], uint64_t cAtoms) const;
+        int                 Invoke(XAtom *apAtoms[], uint64_t cAtoms, void *pvData) const;
 
         /**
          * Assignment operator.
@@ -0,0 +1,248 @@
+/** @file
+ * xank - Native code for machine word Programs, implementation.
+ */
+
+/*
+ * Copyright (C) 2012 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "XJit.h"
+#include "XAtom.h"
+#include "XErrors.h"
+#include "XEvaluatorDefs.h"
+#include "XGenericDefs.h"
+#include "XOperator.h"
+#include "XProgram.h"
+#include "Assert.h"
+
+#include <cstring>
+#include <vector>
+
+#ifdef XANK_HAVE_JIT
+# include <sys/mman.h>
+#endif
+
+/** Native code entry point, returns 0 on completion and 1 if a guard fired. */
+typedef int FNNATIVECODE(int64_t *paiResults, int64_t *paiTemps);
+/** Pointer to the native code entry point. */
+typedef FNNATIVECODE *PFNNATIVECODE;
+
+XJit::XJit()
+    : m_pvCode(NULL),
+    m_cbCode(0)
+{
+}
+
+
+XJit::~XJit()
+{
+#ifdef XANK_HAVE_JIT
+    if (m_pvCode)
+        munmap(m_pvCode, m_cbCode);
+#endif
+}
+
+
+bool XJit::IsSupported()
+{
+#ifdef XANK_HAVE_JIT
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+#ifdef XANK_HAVE_JIT
+/**
+ * An x86-64 code buffer.
+ */
+typedef struct XCodeBuffer
+{
+    std::vector<uint8_t>    abCode;
+
+    void Byte(uint8_t b)
+    {
+        abCode.push_back(b);
+    }
+
+    void Bytes(const uint8_t *pb, size_t cb)
+    {
+        abCode.insert(abCode.end(), pb, pb + cb);
+    }
+
+    void U32(uint32_t u)
+    {
+        for (unsigned i = 0; i < 4; i++)
+            abCode.push_back((uint8_t)(u >> (i * 8)));
+    }
+
+    void U64(uint64_t u)
+    {
+        for (unsigned i = 0; i < 8; i++)
+            abCode.push_back((uint8_t)(u >> (i * 8)));
+    }
+} XCodeBuffer;
+#endif
+
+
+int XJit::Compile(const XProgram *pcProgram)
+{
+#ifdef XANK_HAVE_JIT
+    AssertReturn(!m_pvCode, ERR_INVALID_PARAMETER);
+
+    /*
+     * The operand stack is the machine stack, rsi points to the temporaries and rdi to the
+     * results, both are arrays of int64_t. rsp is saved in rdx so a guard can bail out from
+     * any depth. Only rax and rcx are used for computing.
+     */
+    if (   pcProgram->MaxStackDepth() > XANK_JIT_MAX_STACK_DEPTH
+        || pcProgram->Temps() > INT32_MAX / sizeof(int64_t)
+        || pcProgram->Results() > INT32_MAX / sizeof(int64_t))
+        return ERR_NOT_SUPPORTED;
+
+    static const uint8_t s_abMovRdxRsp[]  = { 0x48, 0x89, 0xe2 };
+    static const uint8_t s_abMovRaxTop[]  = { 0x48, 0x8b, 0x04, 0x24 };
+    static const uint8_t s_abAddRaxRcx[]  = { 0x48, 0x01, 0xc8 };
+    static const uint8_t s_abJo[]         = { 0x0f, 0x80 };
+    static const uint8_t s_abMovTempRax[] = { 0x48, 0x89, 0x86 };
+    static const uint8_t s_abMovRaxTemp[] = { 0x48, 0x8b, 0x86 };
+    static const uint8_t s_abMovResRax[]  = { 0x48, 0x89, 0x87 };
+    static const uint8_t s_abMovRsp[]     = { 0x48, 0x89, 0xd4 };
+    static const uint8_t s_abMovRaxImm[]  = { 0x48, 0xb8 };
+    const uint8_t bPushRax = 0x50;
+    const uint8_t bPopRax  = 0x58;
+    const uint8_t bPopRcx  = 0x59;
+    const uint8_t bRet     = 0xc3;
+
+    XCodeBuffer Code;
+    std::vector<size_t> aoffGuards;     /* Offsets of the rel32 of each guard jump. */
+    Code.Bytes(s_abMovRdxRsp, sizeof(s_abMovRdxRsp));
+
+    const XInstruction *paInstructions = pcProgram->Instructions();
+    for (size_t i = 0; i < pcProgram->Size(); i++)
+    {
+        const XInstruction *pcInstr = &paInstructions[i];
+        switch (pcInstr->enmOp)
+        {
+            case enmInstructionOpPushConstant:
+            case enmInstructionOpPushConstantOperator:
+            {
+                const XAtom *pcConstant = pcProgram->Constant(pcInstr->u.idxConstant);
+                if (!pcConstant->IsSmallInteger())
+                    return ERR_NOT_SUPPORTED;
+                Code.Bytes(s_abMovRaxImm, sizeof(s_abMovRaxImm));
+                Code.U64((uint64_t)pcConstant->SmallInteger());
+                Code.Byte(bPushRax);
+                break;
+            }
+
+            case enmInstructionOpOperator:
+            case enmInstructionOpOperatorInteger:
+            {
+                /* Addition of the topmost operands, the order doesn't matter, any overflow bails out. */
+                if (   pcInstr->u.pcOperator->Id() != XANK_ADD_OPERATOR_ID
+                    || pcInstr->cParams < 2)
+                    return ERR_NOT_SUPPORTED;
+                Code.Byte(bPopRax);
+                for (uint32_t k = 1; k < pcInstr->cParams; k++)
+                {
+                    Code.Byte(bPopRcx);
+                    Code.Bytes(s_abAddRaxRcx, sizeof(s_abAddRaxRcx));
+                    Code.Bytes(s_abJo, sizeof(s_abJo));
+                    aoffGuards.push_back(Code.abCode.size());
+                    Code.U32(0);
+                }
+                Code.Byte(bPushRax);
+                break;
+            }
+
+            case enmInstructionOpStore:
+                Code.Bytes(s_abMovRaxTop, sizeof(s_abMovRaxTop));
+                Code.Bytes(s_abMovTempRax, sizeof(s_abMovTempRax));
+                Code.U32((uint32_t)(pcInstr->u.idxTemp * sizeof(int64_t)));
+                break;
+
+            case enmInstructionOpLoad:
+                Code.Bytes(s_abMovRaxTemp, sizeof(s_abMovRaxTemp));
+                Code.U32((uint32_t)(pcInstr->u.idxTemp * sizeof(int64_t)));
+                Code.Byte(bPushRax);
+                break;
+
+            default:
+                return ERR_NOT_SUPPORTED;
+        }
+    }
+
+    /*
+     * Pop the results, the last one is on top. Return 0, the guards return 1.
+     */
+    for (size_t i = pcProgram->Results(); i-- > 0; )
+    {
+        Code.Byte(bPopRax);
+        Code.Bytes(s_abMovResRax, sizeof(s_abMovResRax));
+        Code.U32((uint32_t)(i * sizeof(int64_t)));
+    }
+    static const uint8_t s_abXorEaxEax[] = { 0x31, 0xc0 };
+    Code.Bytes(s_abXorEaxEax, sizeof(s_abXorEaxEax));
+    Code.Byte(bRet);
+
+    const size_t offGuard = Code.abCode.size();
+    static const uint8_t s_abMovEax1[] = { 0xb8, 0x01, 0x00, 0x00, 0x00 };
+    Code.Bytes(s_abMovRsp, sizeof(s_abMovRsp));
+    Code.Bytes(s_abMovEax1, sizeof(s_abMovEax1));
+    Code.Byte(bRet);
+
+    for (size_t i = 0; i < aoffGuards.size(); i++)
+    {
+        const int32_t offRel = (int32_t)(offGuard - (aoffGuards[i] + 4));
+        for (unsigned k = 0; k < 4; k++)
+            Code.abCode[aoffGuards[i] + k] = (uint8_t)((uint32_t)offRel >> (k * 8));
+    }
+
+    /*
+     * Map it writable, then executable but no longer writable.
+     */
+    const size_t cbCode = Code.abCode.size();
+    void *pvCode = mmap(NULL, cbCode, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (pvCode == MAP_FAILED)
+        return ERR_NO_MEMORY;
+    std::memcpy(pvCode, &Code.abCode[0], cbCode);
+    if (mprotect(pvCode, cbCode, PROT_READ | PROT_EXEC))
+    {
+        munmap(pvCode, cbCode);
+        return ERR_GENERAL_FAILURE;
+    }
+
+    m_pvCode = pvCode;
+    m_cbCode = cbCode;
+    return INF_SUCCESS;
+#else
+    NOREF(pcProgram);
+    return ERR_NOT_SUPPORTED;
+#endif
+}
+
+
+bool XJit::Run(int64_t *paiResults, int64_t *paiTemps) const
+{
+    AssertReturn(m_pvCode, false);
+    PFNNATIVECODE pfnCode;
+    AssertCompile(sizeof(pfnCode) == sizeof(m_pvCode));
+    std::memcpy(&pfnCode, &m_pvCode, sizeof(pfnCode));     /* Object to function pointer, not allowed by a cast. */
+    return !pfnCode(paiResults, paiTemps);
+}
+
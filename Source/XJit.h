@@ -0,0 +1,89 @@
+/** @file
+ * xank - Native code for machine word Programs, header.
+ */
+
+/*
+ * Copyright (C) 2012 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XANK_JIT_H
+# define XANK_JIT_H
+
+#include <stdint.h>
+#include <cstddef>
+
+#if defined(__x86_64__) && defined(XANK_OS_LINUX)
+/** Native code can be generated on this platform. */
+# define XANK_HAVE_JIT
+#endif
+
+/** Maximum operand stack depth of a Program compiled to native code, it lives on the
+ *  machine stack. */
+#define XANK_JIT_MAX_STACK_DEPTH                    4096
+
+class XProgram;
+
+/**
+ * Native code for a Program.
+ * Programs that only compute with integers fitting a machine word can be compiled to
+ * x86-64 code in an executable mapping, without any external toolchain. Every operation
+ * is guarded against overflow, when a guard fires the code bails out and the Program
+ * must be interpreted instead.
+ */
+class XJit
+{
+    public:
+        XJit();
+        virtual ~XJit();
+
+        /**
+         * Returns if native code can be generated on this platform.
+         *
+         * @return bool: true if supported, false otherwise.
+         */
+        static bool                 IsSupported();
+
+        /**
+         * Compiles a Program to native code.
+         *
+         * @param pcProgram         The Program.
+         *
+         * @return int: xank error code, ERR_NOT_SUPPORTED if the Program doesn't
+         *         compute with machine words only or the platform isn't supported.
+         */
+        int                         Compile(const XProgram *pcProgram);
+
+        /**
+         * Runs the native code.
+         *
+         * @param paiResults        Where to store the Program's results.
+         * @param paiTemps          Storage for the Program's temporaries.
+         *
+         * @return bool: true if it ran to completion, false if a guard fired and the
+         *         Program must be interpreted.
+         */
+        bool                        Run(int64_t *paiResults, int64_t *paiTemps) const;
+
+    private:
+        XJit(const XJit &);                         /* Not copyable. */
+        XJit &operator =(const XJit &);             /* Not assignable. */
+
+        void                       *m_pvCode;       /**< The executable mapping. */
+        size_t                      m_cbCode;       /**< Size of the mapping in bytes. */
+};
+
+#endif /* XANK_JIT_H */
+
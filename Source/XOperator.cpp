@@ -31,14 +31,20 @@ XOperator::XOperator()
 }
 
 
-XOperator::XOperator(uint32_t uId, int32_t iPriority, XOperatorDir Direction, uint8_t cParams, std::string sName,
-                    PFNOPERATOR pfnOperator, std::string sShortDesc, std::string sLongDesc)
+XOperator::XOperator(uint32_t uId, int32_t iPriority, XOperatorDir Direction, uint8_t cParams, uint32_t fFlags, std::string sName,
+                    PFNOPERATOR pfnOperator, PFNOPERATOR pfnInteger, PFNOPERATOR pfnFloat, PFNOPERATOR pfnFixed,
+                    PFNOPERATORDOUBLE pfnDouble, std::string sShortDesc, std::string sLongDesc)
     : m_uId(uId),
     m_iPriority(iPriority),
     m_Dir(Direction),
     m_cParams(cParams),
+    m_fFlags(fFlags),
     m_sName(sName),
     m_pfnOperator(pfnOperator),
+    m_pfnInteger(pfnInteger),
+    m_pfnFloat(pfnFloat),
+    m_pfnFixed(pfnFixed),
+    m_pfnDouble(pfnDouble),
     m_sShortDesc(sShortDesc),
     m_sLongDesc(sLongDesc)
 {
@@ -68,7 +74,7 @@ std::string XOperator::LongDesc() const
 }
 
 
-std::string XOperator::Name() const
+const std::string &XOperator::Name() const
 {
     return m_sName;
 }
@@ -86,6 +92,18 @@ uint8_t XOperator::Params() const
 }
 
 
+uint32_t XOperator::Flags() const
+{
+    return m_fFlags;
+}
+
+
+bool XOperator::IsAssociative() const
+{
+    return !!(m_fFlags & XANK_OPERATOR_F_ASSOCIATIVE);
+}
+
+
 int32_t XOperator::Priority() const
 {
     return m_iPriority;
@@ -129,6 +147,30 @@ PFNOPERATOR XOperator::Function() const
 }
 
 
+PFNOPERATOR XOperator::IntegerFunction() const
+{
+    return m_pfnInteger;
+}
+
+
+PFNOPERATOR XOperator::FloatFunction() const
+{
+    return m_pfnFloat;
+}
+
+
+PFNOPERATOR XOperator::FixedFunction() const
+{
+    return m_pfnFixed;
+}
+
+
+PFNOPERATORDOUBLE XOperator::DoubleFunction() const
+{
+    return m_pfnDouble;
+}
+
+
 std::string XOperator::PrintToString() const
 {
     /** @todo fill in the other members here  */
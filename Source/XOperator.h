@@ -23,6 +23,7 @@
 # define XANK_OPERATOR_H
 
 #include <stdint.h>
+#include <cstddef>
 
 #include <string>
 
@@ -39,11 +40,42 @@ enum XOperatorDir
     enmOperatorDirRight
 };
 
-/** An Operator function. */
+/** The Operator is associative, a chain of it may be evaluated as one n-ary
+ *  invocation summing up its operands left to right. See FuseOperators(). */
+#define XANK_OPERATOR_F_ASSOCIATIVE             0x1
+
+/**
+ * An Operator function.
+ * The result is written in place into the first operand, apAtoms[0], reusing its
+ * storage where possible. Other operands are only read, in place, and may be
+ * constants of the Program being evaluated. Associative Operators must accept
+ * any cAtoms of two or more. pvData is the evaluator's XScratchPool for GMP
+ * temporaries, except for fixed-width functions, see XOperator::FixedFunction().
+ */
 typedef int FNOPERATOR(XAtom *apAtoms[], size_t cAtoms, void *pvData);
 /** Pointer to an Operator function. */
 typedef FNOPERATOR *PFNOPERATOR;
 
+/**
+ * A double with a bound on its absolute error, see XANK_SETTING_DOUBLE_TIER.
+ */
+typedef struct XBoundedDouble
+{
+    /** The value. */
+    double                  rValue;
+    /** Bound on the absolute difference between the value and the exact one. */
+    double                  rError;
+} XBoundedDouble;
+
+/**
+ * An Operator function for the double tier.
+ * The result and its error bound are written into paValues[0]. It never fails, a
+ * result out of the range of a double has an infinite or NaN error bound.
+ */
+typedef void FNOPERATORDOUBLE(XBoundedDouble *paValues, size_t cValues);
+/** Pointer to an Operator function for the double tier. */
+typedef FNOPERATORDOUBLE *PFNOPERATORDOUBLE;
+
 /**
  * An Operator.
  * An Operator performs an operation on one or more operands.
@@ -52,8 +84,9 @@ class XOperator
 {
     public:
         XOperator();
-        XOperator(uint32_t uId, int32_t iPriority, XOperatorDir Dir, uint8_t cParams, std::string sName,
-            PFNOPERATOR pfnOperator, std::string sShortDesc, std::string sLongDesc);
+        XOperator(uint32_t uId, int32_t iPriority, XOperatorDir Dir, uint8_t cParams, uint32_t fFlags, std::string sName,
+            PFNOPERATOR pfnOperator, PFNOPERATOR pfnInteger, PFNOPERATOR pfnFloat, PFNOPERATOR pfnFixed,
+            PFNOPERATORDOUBLE pfnDouble, std::string sShortDesc, std::string sLongDesc);
         virtual ~XOperator();
 
         /**
@@ -85,11 +118,25 @@ class XOperator
         uint8_t                 Params() const;
 
         /**
-         * Returns a copy of the name of this Operator.
+         * Returns the XANK_OPERATOR_F_XXX flags of this Operator.
          *
-         * @return std::string
+         * @return uint32_t
+         */
+        uint32_t                Flags() const;
+
+        /**
+         * Returns if this Operator is associative.
+         *
+         * @return bool: true if it's associative, false otherwise.
+         */
+        bool                    IsAssociative() const;
+
+        /**
+         * Returns the name of this Operator.
+         *
+         * @return const std::string&
          */
-        std::string             Name() const;
+        const std::string      &Name() const;
 
         /**
          * Returns a copy of the short description of this Operator.
@@ -112,12 +159,45 @@ class XOperator
          */
         PFNOPERATOR             Function() const;
 
+        /**
+         * Returns a pointer to the function of this Operator specialised for
+         * operands that are all integers, if any.
+         *
+         * @return PFNOPERATOR: The function or NULL.
+         */
+        PFNOPERATOR             IntegerFunction() const;
+
+        /**
+         * Returns a pointer to the function of this Operator specialised for
+         * operands that are all floats, if any.
+         *
+         * @return PFNOPERATOR: The function or NULL.
+         */
+        PFNOPERATOR             FloatFunction() const;
+
+        /**
+         * Returns a pointer to the function of this Operator for fixed-width
+         * integer operands, if any. Its pvData is the XFixedWidth of the Program.
+         *
+         * @return PFNOPERATOR: The function or NULL.
+         */
+        PFNOPERATOR             FixedFunction() const;
+
+        /**
+         * Returns a pointer to the function of this Operator for the double tier,
+         * if any.
+         *
+         * @return PFNOPERATORDOUBLE: The function or NULL.
+         */
+        PFNOPERATORDOUBLE       DoubleFunction() const;
+
         /**
          * Invokes the function associated with this Operator.
          *
-         * @param apAtoms               Array of pointers to operand Atoms.
+         * @param apAtoms               Array of pointers to operand Atoms, the result
+         *                              is stored in apAtoms[0].
          * @param cAtoms                Number of items in @a apAtoms.
-         * @param pvData                Private data.
+         * @param pvData                Private data, the evaluator's XScratchPool.
          *
          * @return int: xank error code.
          */
@@ -163,8 +243,13 @@ class XOperator
         int32_t                 m_iPriority;    /**< Operator priority, value is relative to Operators. */
         XOperatorDir            m_Dir;          /**< Operator associativity direction. */
         uint8_t                 m_cParams;      /**< Number of parameters to the operator, see XANK_MAX_OPERATOR_PARAMETERS. */
+        uint32_t                m_fFlags;       /**< XANK_OPERATOR_F_XXX flags. */
         std::string             m_sName;        /**< Name of the Operator as seen in the expression. */
         PFNOPERATOR             m_pfnOperator;  /**< Pointer to the Operator evaluator function. */
+        PFNOPERATOR             m_pfnInteger;   /**< Pointer to the evaluator function for integer operands, optional. */
+        PFNOPERATOR             m_pfnFloat;     /**< Pointer to the evaluator function for float operands, optional. */
+        PFNOPERATOR             m_pfnFixed;     /**< Pointer to the evaluator function for fixed-width integers, optional. */
+        PFNOPERATORDOUBLE       m_pfnDouble;    /**< Pointer to the evaluator function for the double tier, optional. */
         std::string             m_sShortDesc;   /**< Short description of the Operator. */
         std::string             m_sLongDesc;    /**< Long description of the Operator. */
 };
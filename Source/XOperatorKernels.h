@@ -0,0 +1,267 @@
+/** @file
+ * xank - Operator kernel templates.
+ */
+
+/*
+ * Copyright (C) 2012 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XANK_OPERATOR_KERNELS_H
+# define XANK_OPERATOR_KERNELS_H
+
+#include <stdint.h>
+#include <cstddef>
+
+#include <gmp.h>
+
+#include "XAtom.h"
+#include "XErrors.h"
+#include "XFixedWidth.h"
+#include "XGenericDefs.h"
+#include "XOperator.h"
+#include "XScratchPool.h"
+#include "Assert.h"
+
+/**
+ * Base of the arithmetic of an Operator, from which its kernels are generated.
+ *
+ * The arithmetic of an Operator derives from this, passing itself as TArith, and
+ * defines the operation once per representation of a number:
+ *
+ *     static bool Native(int64_t iLeft, int64_t iRight, int64_t *piResult);
+ *         Small integers, returns true if the result overflowed.
+ *     static void Integer(mpz_ptr pDst, mpz_srcptr pcSrc);
+ *         GMP integers, in place into pDst.
+ *     static void Float(mpf_ptr pDst, mpf_srcptr pcSrc);
+ *         GMP floats, in place into pDst.
+ *     static uint64_t Wrapping(uint64_t uLeft, uint64_t uRight);
+ *         Machine words, returns the result modulo 2^64.
+ *     static int64_t SaturatingSigned(int64_t iLeft, int64_t iRight, int64_t iMin, int64_t iMax);
+ *         Signed machine words within [iMin, iMax], returns the result clamped to that.
+ *     static uint64_t SaturatingUnsigned(uint64_t uLeft, uint64_t uRight, uint64_t uMax);
+ *         Unsigned machine words up to uMax, returns the result clamped to that.
+ *     static XBoundedDouble Double(XBoundedDouble Left, XBoundedDouble Right);
+ *         Doubles, returns the result with a bound on its error.
+ *
+ * The forms taking operands of mixed representations are derived from those here by
+ * converting the operand in a scratch register. The arithmetic may hide any of them
+ * with a faster one of its own.
+ */
+template <class TArith>
+struct XArithBase
+{
+    static int IntegerSmall(mpz_ptr pDst, int64_t iValue, XScratchPool *pPool)
+    {
+        mpz_ptr pValue = pPool->AcquireInteger();
+        if (!pValue)
+            return ERR_NO_MEMORY;
+        XAtom Value;
+        Value.SetSmallInteger(iValue);
+        Value.GetInteger(pValue);
+        TArith::Integer(pDst, pValue);
+        pPool->ReleaseInteger(pValue);
+        return INF_SUCCESS;
+    }
+
+    static int FloatSmall(mpf_ptr pDst, int64_t iValue, XScratchPool *pPool)
+    {
+        mpf_ptr pValue = pPool->AcquireFloat();
+        if (!pValue)
+            return ERR_NO_MEMORY;
+        XAtom Value;
+        Value.SetSmallInteger(iValue);
+        Value.PromoteGetFloat(pValue);
+        TArith::Float(pDst, pValue);
+        pPool->ReleaseFloat(pValue);
+        return INF_SUCCESS;
+    }
+
+    static int FloatInteger(mpf_ptr pDst, mpz_srcptr pcValue, XScratchPool *pPool)
+    {
+        mpf_ptr pValue = pPool->AcquireFloat();
+        if (!pValue)
+            return ERR_NO_MEMORY;
+        mpf_set_z(pValue, pcValue);
+        TArith::Float(pDst, pValue);
+        pPool->ReleaseFloat(pValue);
+        return INF_SUCCESS;
+    }
+};
+
+
+/**
+ * Operator kernels generated from the arithmetic of an Operator, see XArithBase.
+ * They are FNOPERATOR functions applying the operation left to right over two or
+ * more operands into apAtoms[0], covering every combination of small integer,
+ * GMP integer and GMP float operands. Integers are promoted when a float operand
+ * is reached, the same as a chain of binary operations.
+ */
+template <class TArith>
+class XOperatorKernels
+{
+    public:
+        /**
+         * Kernel for operands of any number type.
+         */
+        static int Generic(XAtom *apAtoms[], size_t cAtoms, void *pvData)
+        {
+            XScratchPool *pPool = (XScratchPool *)pvData;
+            AssertReturn(pPool, ERR_INVALID_PARAMETER);
+            AssertReturn(cAtoms >= 2, ERR_INVALID_PARAMETER);
+            for (size_t i = 0; i < cAtoms; i++)
+            {
+                if (!apAtoms[i]->IsNumber())
+                    return ERR_INVALID_ATOM_TYPE_FOR_OPERATION;
+            }
+
+            size_t i = 1;
+            if (apAtoms[0]->IsInteger())
+            {
+                int rc = AccumulateIntegers(apAtoms, &i, cAtoms, pPool);
+                if (   IS_FAILURE(rc)
+                    || i == cAtoms)
+                    return rc;
+            }
+            return AccumulateFloats(apAtoms, i, cAtoms, pPool);
+        }
+
+        /**
+         * Kernel for operands known to be integers.
+         */
+        static int Integer(XAtom *apAtoms[], size_t cAtoms, void *pvData)
+        {
+            size_t i = 1;
+            int rc = AccumulateIntegers(apAtoms, &i, cAtoms, (XScratchPool *)pvData);
+            AssertReturn(IS_FAILURE(rc) || i == cAtoms, ERR_INVALID_ATOM_TYPE_FOR_OPERATION);
+            return rc;
+        }
+
+        /**
+         * Kernel for fixed-width integer operands, pvData is the XFixedWidth.
+         */
+        static int Fixed(XAtom *apAtoms[], size_t cAtoms, void *pvData)
+        {
+            const XFixedWidth *pcWidth = (const XFixedWidth *)pvData;
+            AssertReturn(pcWidth && pcWidth->IsFixed(), ERR_INVALID_PARAMETER);
+            AssertReturn(apAtoms[0]->IsSmallInteger(), ERR_INVALID_ATOM_TYPE_FOR_OPERATION);
+            int64_t iAcc = apAtoms[0]->SmallInteger();
+            for (size_t i = 1; i < cAtoms; i++)
+            {
+                Assert(apAtoms[i]->IsSmallInteger());
+                const int64_t iValue = apAtoms[i]->SmallInteger();
+                if (!pcWidth->IsSaturating())
+                    iAcc = pcWidth->Wrap(TArith::Wrapping((uint64_t)iAcc, (uint64_t)iValue));
+                else if (pcWidth->IsSigned())
+                    iAcc = TArith::SaturatingSigned(iAcc, iValue, pcWidth->Min(), pcWidth->Max());
+                else
+                    iAcc = (int64_t)TArith::SaturatingUnsigned((uint64_t)iAcc, (uint64_t)iValue, pcWidth->UnsignedMax());
+            }
+            return apAtoms[0]->SetSmallInteger(iAcc);
+        }
+
+        /**
+         * Kernel for the double tier.
+         */
+        static void Double(XBoundedDouble *paValues, size_t cValues)
+        {
+            XBoundedDouble Acc = paValues[0];
+            for (size_t i = 1; i < cValues; i++)
+                Acc = TArith::Double(Acc, paValues[i]);
+            paValues[0] = Acc;
+        }
+
+        /**
+         * Kernel for operands known to be floats.
+         */
+        static int Float(XAtom *apAtoms[], size_t cAtoms, void *pvData)
+        {
+            NOREF(pvData);
+            Assert(apAtoms[0]->IsFloat());
+            mpf_ptr pDst = apAtoms[0]->MutableFloat(0);
+            for (size_t i = 1; i < cAtoms; i++)
+            {
+                Assert(apAtoms[i]->IsFloat());
+                TArith::Float(pDst, apAtoms[i]->Float());
+            }
+            return INF_SUCCESS;
+        }
+
+    private:
+        /**
+         * Applies integer operands starting at *pi to apAtoms[0], an integer: natively
+         * while the result fits, then in one GMP integer. Stops at the first operand that
+         * isn't an integer, updating *pi.
+         */
+        static int AccumulateIntegers(XAtom *apAtoms[], size_t *pi, size_t cAtoms, XScratchPool *pPool)
+        {
+            XAtom *pDst = apAtoms[0];
+            size_t i    = *pi;
+            Assert(pDst->IsInteger());
+            if (pDst->IsSmallInteger())
+            {
+                int64_t iAcc = pDst->SmallInteger();
+                for (; i < cAtoms && apAtoms[i]->IsSmallInteger(); i++)
+                {
+                    int64_t iResult;
+                    if (TArith::Native(iAcc, apAtoms[i]->SmallInteger(), &iResult))
+                        break;  /* Overflowed, continue with GMP from this operand. */
+                    iAcc = iResult;
+                }
+                pDst->SetSmallInteger(iAcc);
+                if (   i == cAtoms
+                    || !apAtoms[i]->IsInteger())
+                {
+                    *pi = i;
+                    return INF_SUCCESS;
+                }
+            }
+
+            int rc = INF_SUCCESS;
+            mpz_ptr pAcc = pDst->MutableInteger();
+            for (; i < cAtoms && apAtoms[i]->IsInteger() && IS_SUCCESS(rc); i++)
+            {
+                if (apAtoms[i]->IsSmallInteger())
+                    rc = TArith::IntegerSmall(pAcc, apAtoms[i]->SmallInteger(), pPool);
+                else
+                    TArith::Integer(pAcc, apAtoms[i]->BigInteger());
+            }
+            pDst->NormalizeInteger();
+            *pi = i;
+            return rc;
+        }
+
+        /**
+         * Applies number operands starting at i to apAtoms[0] as a float.
+         */
+        static int AccumulateFloats(XAtom *apAtoms[], size_t i, size_t cAtoms, XScratchPool *pPool)
+        {
+            int rc = INF_SUCCESS;
+            mpf_ptr pAcc = apAtoms[0]->MutableFloat(pPool->FloatPrecision());
+            for (; i < cAtoms && IS_SUCCESS(rc); i++)
+            {
+                if (apAtoms[i]->IsFloat())
+                    TArith::Float(pAcc, apAtoms[i]->Float());
+                else if (apAtoms[i]->IsSmallInteger())
+                    rc = TArith::FloatSmall(pAcc, apAtoms[i]->SmallInteger(), pPool);
+                else
+                    rc = TArith::FloatInteger(pAcc, apAtoms[i]->BigInteger(), pPool);
+            }
+            return rc;
+        }
+};
+
+#endif /* XANK_OPERATOR_KERNELS_H */
+
@@ -0,0 +1,169 @@
+/** @file
+ * xank - Operator Trie, implementation.
+ */
+
+/*
+ * Copyright (C) 2012 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "XOperatorTrie.h"
+#include "XOperator.h"
+#include "XEvaluatorDefs.h"
+#include "XErrors.h"
+#include "Assert.h"
+
+#include <algorithm>
+#include <cstring>
+
+XOperatorTrie::XOperatorTrie()
+    : m_cClasses(0)
+{
+    std::memset(m_abClass, 0, sizeof(m_abClass));
+}
+
+
+XOperatorTrie::~XOperatorTrie()
+{
+}
+
+
+static bool OperatorParamsCompare(const XOperator *pcOperator1, const XOperator *pcOperator2)
+{
+    return pcOperator1->Params() > pcOperator2->Params();
+}
+
+
+int XOperatorTrie::Build(const XOperator *paOperators, size_t cOperators)
+{
+    m_Nodes.clear();
+    m_Children.clear();
+    m_apcOperators.clear();
+    std::memset(m_abClass, 0, sizeof(m_abClass));
+    m_cClasses = 0;
+
+    /*
+     * Assign a class to every character used by an Operator name, so each node only needs
+     * as many children slots as there are distinct characters rather than 256.
+     */
+    for (size_t i = 0; i < cOperators; i++)
+    {
+        const std::string &scName = paOperators[i].Name();
+        if (   scName.empty()
+            || scName.length() > XANK_MAX_OPERATOR_NAME_LEN)
+            return ERR_INVALID_OPERATOR;
+
+        for (size_t k = 0; k < scName.length(); k++)
+        {
+            const unsigned char uch = scName[k];
+            if (!m_abClass[uch])
+                m_abClass[uch] = (uint8_t)++m_cClasses;
+        }
+    }
+
+    /*
+     * Insert the names, remembering the node each Operator ends at.
+     */
+    const Node EmptyNode = { 0, 0 };
+    m_Nodes.push_back(EmptyNode);
+    m_Children.resize(m_cClasses, 0);
+
+    std::vector<uint32_t> aidxNodes(cOperators);
+    for (size_t i = 0; i < cOperators; i++)
+    {
+        const std::string &scName = paOperators[i].Name();
+        uint32_t idxNode = 0;
+        for (size_t k = 0; k < scName.length(); k++)
+        {
+            const size_t idxChild = idxNode * m_cClasses + m_abClass[(unsigned char)scName[k]] - 1;
+            if (!m_Children[idxChild])
+            {
+                m_Children[idxChild] = (uint32_t)m_Nodes.size();
+                m_Nodes.push_back(EmptyNode);
+                m_Children.resize(m_Children.size() + m_cClasses, 0);
+            }
+            idxNode = m_Children[idxChild];
+        }
+        aidxNodes[i] = idxNode;
+        m_Nodes[idxNode].cOperators++;
+    }
+
+    /*
+     * Group the Operators by node, and order Operators with the same name such that the one
+     * taking more parameters comes first, e.g. binary '-' before unary '-'. See ParseOperator().
+     */
+    uint32_t idxOperators = 0;
+    for (size_t i = 0; i < m_Nodes.size(); i++)
+    {
+        m_Nodes[i].idxOperators = idxOperators;
+        idxOperators           += m_Nodes[i].cOperators;
+        m_Nodes[i].cOperators   = 0;
+    }
+
+    m_apcOperators.resize(cOperators);
+    for (size_t i = 0; i < cOperators; i++)
+    {
+        Node *pNode = &m_Nodes[aidxNodes[i]];
+        m_apcOperators[pNode->idxOperators + pNode->cOperators++] = &paOperators[i];
+    }
+
+    for (size_t i = 0; i < m_Nodes.size(); i++)
+    {
+        if (m_Nodes[i].cOperators > 1)
+        {
+            std::vector<const XOperator*>::iterator itFirst = m_apcOperators.begin() + m_Nodes[i].idxOperators;
+            std::stable_sort(itFirst, itFirst + m_Nodes[i].cOperators, OperatorParamsCompare);
+        }
+    }
+
+    return INF_SUCCESS;
+}
+
+
+size_t XOperatorTrie::Match(const char *pcszExpr, XOperatorMatch *paMatches, size_t cMatches) const
+{
+    if (m_Nodes.empty())
+        return 0;
+
+    size_t cFound   = 0;
+    size_t cchName  = 0;
+    uint32_t idxNode = 0;
+    while (pcszExpr[cchName])
+    {
+        const uint8_t uClass = m_abClass[(unsigned char)pcszExpr[cchName]];
+        if (!uClass)
+            break;
+
+        idxNode = m_Children[idxNode * m_cClasses + uClass - 1];
+        if (!idxNode)
+            break;
+
+        ++cchName;
+        const Node *pcNode = &m_Nodes[idxNode];
+        if (   pcNode->cOperators
+            && cFound < cMatches)
+        {
+            paMatches[cFound].cchName       = cchName;
+            paMatches[cFound].papcOperators = &m_apcOperators[pcNode->idxOperators];
+            paMatches[cFound].cOperators    = pcNode->cOperators;
+            ++cFound;
+        }
+    }
+
+    /* Longest name first. */
+    std::reverse(paMatches, paMatches + cFound);
+    return cFound;
+}
+
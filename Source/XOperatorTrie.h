@@ -0,0 +1,102 @@
+/** @file
+ * xank - Operator Trie, header.
+ */
+
+/*
+ * Copyright (C) 2012 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XANK_OPERATOR_TRIE_H
+# define XANK_OPERATOR_TRIE_H
+
+#include <stdint.h>
+#include <cstddef>
+
+#include <vector>
+
+class XOperator;
+
+/**
+ * An Operator name matched by XOperatorTrie::Match().
+ */
+typedef struct XOperatorMatch
+{
+    /** Length of the matched name in bytes. */
+    size_t                      cchName;
+    /** Array of Operators with this name, in order of preference. */
+    const XOperator *const     *papcOperators;
+    /** Number of items in @a papcOperators. */
+    size_t                      cOperators;
+} XOperatorMatch;
+
+/**
+ * An Operator Trie.
+ * Maps Operator names to Operators, finding every Operator name that is a
+ * prefix of the input in a single pass over the input bytes.
+ */
+class XOperatorTrie
+{
+    public:
+        XOperatorTrie();
+        virtual ~XOperatorTrie();
+
+        /**
+         * Builds the trie from an array of Operators, discarding any previous
+         * contents. Operators sharing a name are ordered such that the one taking
+         * more parameters is preferred, e.g. binary '-' before unary '-'.
+         *
+         * @param paOperators       Array of Operators.
+         * @param cOperators        Number of items in @a paOperators.
+         *
+         * @return int: xank error code.
+         */
+        int                         Build(const XOperator *paOperators, size_t cOperators);
+
+        /**
+         * Finds all Operator names that are a prefix of the expression.
+         *
+         * @param pcszExpr          The expression.
+         * @param paMatches         Where to store the matches, longest name first.
+         * @param cMatches          Number of items in @a paMatches, at least
+         *                          XANK_MAX_OPERATOR_NAME_LEN to never miss a match.
+         *
+         * @return size_t: Number of matches stored in @a paMatches.
+         */
+        size_t                      Match(const char *pcszExpr, XOperatorMatch *paMatches, size_t cMatches) const;
+
+    private:
+        /**
+         * A Trie node.
+         * The children of a node are stored in the children table, indexed by
+         * node and character class.
+         */
+        typedef struct Node
+        {
+            /** Index of the first Operator ending at this node in m_apcOperators. */
+            uint32_t                idxOperators;
+            /** Number of Operators ending at this node. */
+            uint32_t                cOperators;
+        } Node;
+
+        std::vector<Node>               m_Nodes;        /**< The nodes, the root is at index 0. */
+        std::vector<uint32_t>           m_Children;     /**< Children table, 0 means no child. */
+        std::vector<const XOperator*>   m_apcOperators; /**< Operators grouped by the node they end at. */
+        uint8_t                         m_abClass[256]; /**< Character to class map, 0 means not used by any Operator. */
+        uint32_t                        m_cClasses;     /**< Number of character classes. */
+};
+
+#endif /* XANK_OPERATOR_TRIE_H */
+
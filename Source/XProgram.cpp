@@ -0,0 +1,216 @@
+/** @file
+ * xank - Program, implementation.
+ */
+
+/*
+ * Copyright (C) 2012 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "XProgram.h"
+#include "XFunction.h"
+#include "XOperator.h"
+#include "XJit.h"
+#include "Assert.h"
+
+#include <sstream>
+
+XProgram::XProgram()
+    : m_cMaxDepth(0),
+    m_cTemps(0),
+    m_cResults(0),
+    m_fRegisters(false),
+    m_cRegisters(0),
+    m_cMaxParams(0),
+    m_pJit(NULL),
+    m_fDoubleTier(false),
+    m_rDoubleTolerance(0),
+    m_cFloatDigits(0),
+    m_cFloatBits(0)
+{
+}
+
+
+XProgram::~XProgram()
+{
+    delete m_pJit;
+}
+
+
+size_t XProgram::Size() const
+{
+    return m_Instructions.size();
+}
+
+
+const XInstruction *XProgram::Instructions() const
+{
+    return m_Instructions.empty() ? NULL : &m_Instructions[0];
+}
+
+
+const XAtom *XProgram::Constant(size_t idxConstant) const
+{
+    Assert(idxConstant < m_Constants.size());
+    return &m_Constants[idxConstant];
+}
+
+
+size_t XProgram::MaxStackDepth() const
+{
+    return m_cMaxDepth;
+}
+
+
+size_t XProgram::Results() const
+{
+    return m_cResults;
+}
+
+
+size_t XProgram::Temps() const
+{
+    return m_cTemps;
+}
+
+
+const XFixedWidth &XProgram::FixedWidth() const
+{
+    return m_FixedWidth;
+}
+
+
+uint32_t XProgram::FloatDigits() const
+{
+    return m_cFloatDigits;
+}
+
+
+static void SlotToStream(std::ostringstream &sOut, uint32_t idxSlot, size_t cConstants)
+{
+    if (idxSlot < cConstants)
+        sOut << "#" << idxSlot;
+    else
+        sOut << "r" << idxSlot - cConstants;
+}
+
+
+std::string XProgram::PrintToString() const
+{
+    std::ostringstream sOut;
+    if (m_FixedWidth.IsFixed())
+        sOut << "Integers: " << m_FixedWidth.Name() << (m_FixedWidth.IsSaturating() ? " saturating" : " wrapping") << "\n";
+    if (m_cFloatBits)
+        sOut << "Floats: " << m_cFloatBits << " bits\n";
+
+    for (size_t i = 0; i < m_Instructions.size(); i++)
+    {
+        const XInstruction *pcInstr = &m_Instructions[i];
+        sOut << i << ": ";
+        switch (pcInstr->enmOp)
+        {
+            case enmInstructionOpPushConstant:
+                sOut << "Push     #" << pcInstr->u.idxConstant << " "
+                     << m_Constants[pcInstr->u.idxConstant].PrintToString();
+                break;
+
+            case enmInstructionOpOperator:
+                sOut << "Operator '" << pcInstr->u.pcOperator->Name() << "' cParams=" << pcInstr->cParams;
+                break;
+
+            case enmInstructionOpFunction:
+                sOut << "Function '" << pcInstr->u.pcFunction->Name() << "' cParams=" << pcInstr->cParams;
+                break;
+
+            case enmInstructionOpStore:
+                sOut << "Store    $" << pcInstr->u.idxTemp;
+                break;
+
+            case enmInstructionOpLoad:
+                sOut << "Load     $" << pcInstr->u.idxTemp;
+                break;
+
+            case enmInstructionOpOperatorInteger:
+                sOut << "Operator '" << pcInstr->u.pcOperator->Name() << "' cParams=" << pcInstr->cParams << " Integer";
+                break;
+
+            case enmInstructionOpOperatorFloat:
+                sOut << "Operator '" << pcInstr->u.pcOperator->Name() << "' cParams=" << pcInstr->cParams << " Float";
+                break;
+
+            case enmInstructionOpOperatorFixed:
+                sOut << "Operator '" << pcInstr->u.pcOperator->Name() << "' cParams=" << pcInstr->cParams << " Fixed";
+                break;
+
+            case enmInstructionOpToFloat:
+                sOut << "ToFloat  -" << pcInstr->u.offStack;
+                break;
+
+            case enmInstructionOpPushConstantOperator:
+                sOut << "PushOp   #" << pcInstr->u.idxConstant << " "
+                     << m_Constants[pcInstr->u.idxConstant].PrintToString();
+                break;
+
+            case enmInstructionOpMove:
+                sOut << "Move (register machine only)";
+                break;
+        }
+        if (pcInstr->cFloatBits)
+            sOut << " " << pcInstr->cFloatBits << " bits";
+        sOut << "\n";
+    }
+
+    if (m_fRegisters)
+    {
+        /* Slots below the number of constants are constants, '#', the rest registers, 'r'. */
+        const size_t cConstants = m_Constants.size();
+        sOut << "Registers: " << m_cRegisters << "\n";
+        for (size_t i = 0; i < m_RegInstructions.size(); i++)
+        {
+            const XRegInstruction *pcInstr = &m_RegInstructions[i];
+            sOut << i << ": r" << pcInstr->idxDst << " = ";
+            if (pcInstr->enmOp == enmInstructionOpMove)
+                SlotToStream(sOut, pcInstr->idxOperands, cConstants);
+            else if (pcInstr->enmOp == enmInstructionOpToFloat)
+                sOut << "ToFloat r" << pcInstr->idxDst;
+            else
+            {
+                if (pcInstr->enmOp == enmInstructionOpFunction)
+                    sOut << "Function '" << pcInstr->u.pcFunction->Name() << "'";
+                else
+                    sOut << "Operator '" << pcInstr->u.pcOperator->Name() << "'";
+                for (uint32_t k = 0; k < pcInstr->cParams; k++)
+                {
+                    sOut << " ";
+                    SlotToStream(sOut, m_RegOperands[pcInstr->idxOperands + k], cConstants);
+                }
+                if (pcInstr->enmOp == enmInstructionOpOperatorInteger)
+                    sOut << " Integer";
+                else if (pcInstr->enmOp == enmInstructionOpOperatorFloat)
+                    sOut << " Float";
+                else if (pcInstr->enmOp == enmInstructionOpOperatorFixed)
+                    sOut << " Fixed";
+            }
+            sOut << "\n";
+        }
+    }
+
+    if (m_pJit)
+        sOut << "Native code\n";
+    if (m_fDoubleTier)
+        sOut << "Double tier, relative error up to " << m_rDoubleTolerance << "\n";
+    return sOut.str();
+}
+
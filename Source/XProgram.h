@@ -0,0 +1,230 @@
+/** @file
+ * xank - Program, header.
+ */
+
+/*
+ * Copyright (C) 2012 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XANK_PROGRAM_H
+# define XANK_PROGRAM_H
+
+#include <stdint.h>
+#include <cstddef>
+
+#include <string>
+#include <vector>
+
+#include "XAtom.h"
+#include "XFixedWidth.h"
+#include "XOperator.h"
+
+class XFunction;
+class XJit;
+
+/**
+ * The operation of an Instruction.
+ */
+enum XInstructionOp
+{
+    /** Push a copy of a constant from the constant pool. */
+    enmInstructionOpPushConstant = 0x50,
+    /** Invoke an Operator on the topmost stack items. */
+    enmInstructionOpOperator,
+    /** Invoke a Function on the topmost stack items. */
+    enmInstructionOpFunction,
+    /** Copy the topmost stack item into a temporary, leaving it on the stack. */
+    enmInstructionOpStore,
+    /** Push a copy of a temporary. */
+    enmInstructionOpLoad,
+    /** Invoke the integer function of an Operator, the operands are known to be integers. */
+    enmInstructionOpOperatorInteger,
+    /** Invoke the float function of an Operator, the operands are known to be floats. */
+    enmInstructionOpOperatorFloat,
+    /** Invoke the fixed-width function of an Operator, the Program has fixed-width integers. */
+    enmInstructionOpOperatorFixed,
+    /** Promote an integer stack item to a float in place. */
+    enmInstructionOpToFloat,
+    /** Superinstruction, PushConstant followed by the Operator Instruction after it. */
+    enmInstructionOpPushConstantOperator,
+    /** Copy an operand into a register, register machine only. */
+    enmInstructionOpMove
+};
+
+/**
+ * An Instruction.
+ * A single, fixed-size step of a compiled Program.
+ */
+typedef struct XInstruction
+{
+    /** The operation. */
+    XInstructionOp          enmOp;
+    /** Number of parameters for Operator and Function instructions. */
+    uint32_t                cParams;
+    /** Precision integers are promoted to floats with by Operator, Function and ToFloat
+     *  instructions, 0 for the GMP default, see XEvaluator::PlanPrecisions(). */
+    uint32_t                cFloatBits;
+    union
+    {
+        /** Index into the constant pool for PushConstant and PushConstantOperator instructions. */
+        size_t              idxConstant;
+        /** Pointer to the Operator for Operator, OperatorInteger, OperatorFloat and OperatorFixed instructions. */
+        const XOperator    *pcOperator;
+        /** Pointer to the Function for Function instructions. */
+        const XFunction    *pcFunction;
+        /** Index of the temporary for Store and Load instructions. */
+        size_t              idxTemp;
+        /** Offset of the stack item from the top for ToFloat instructions, 0 being the top. */
+        size_t              offStack;
+    } u;
+} XInstruction;
+
+/**
+ * A register machine Instruction.
+ * A three-address form of an Instruction: Operators and Functions read operand
+ * slots and write a register, which is also where the first operand goes. Slots
+ * below the number of constants are constants, the rest are registers.
+ */
+typedef struct XRegInstruction
+{
+    /** The operation: Operator, OperatorInteger, OperatorFloat, OperatorFixed, Function, ToFloat or Move. */
+    XInstructionOp          enmOp;
+    /** Number of operands for Operator and Function instructions. */
+    uint32_t                cParams;
+    /** The destination register. */
+    uint32_t                idxDst;
+    /** Index of the first operand slot in the operand array, the source slot for Move. */
+    uint32_t                idxOperands;
+    /** Precision integers are promoted to floats with, see XInstruction::cFloatBits. */
+    uint32_t                cFloatBits;
+    union
+    {
+        /** Pointer to the Operator for Operator instructions. */
+        const XOperator    *pcOperator;
+        /** Pointer to the Function for Function instructions. */
+        const XFunction    *pcFunction;
+    } u;
+} XRegInstruction;
+
+/**
+ * A compiled Program.
+ * A Program is the immutable output of parsing an expression, or a batch of
+ * them. The RPN form of the expression is lowered to one contiguous array of
+ * Instructions, and the number literals are kept in a side constant pool. A
+ * Program can be evaluated any number of times, evaluation never modifies it.
+ */
+class XProgram
+{
+    public:
+        XProgram();
+        virtual ~XProgram();
+
+        /**
+         * Returns the number of Instructions in this Program.
+         *
+         * @return size_t
+         */
+        size_t                      Size() const;
+
+        /**
+         * Returns the array of Instructions of this Program.
+         *
+         * @return const XInstruction*: Pointer to the first of Size() Instructions.
+         */
+        const XInstruction         *Instructions() const;
+
+        /**
+         * Returns a constant from the constant pool.
+         *
+         * @param idxConstant       Index of the constant.
+         *
+         * @return const XAtom*: Pointer to the constant Atom.
+         */
+        const XAtom                *Constant(size_t idxConstant) const;
+
+        /**
+         * Returns the maximum depth of the operand stack while evaluating this
+         * Program, computed when compiling it.
+         *
+         * @return size_t
+         */
+        size_t                      MaxStackDepth() const;
+
+        /**
+         * Returns the number of results of this Program, one per expression it was
+         * compiled from.
+         *
+         * @return size_t
+         */
+        size_t                      Results() const;
+
+        /**
+         * Returns the number of temporaries used by Store and Load Instructions of
+         * this Program.
+         *
+         * @return size_t
+         */
+        size_t                      Temps() const;
+
+        /**
+         * Returns the width of the integers of this Program.
+         *
+         * @return const XFixedWidth &
+         */
+        const XFixedWidth          &FixedWidth() const;
+
+        /**
+         * Returns the number of significant decimal digits the float results of this
+         * Program are computed to, as given when parsing it.
+         *
+         * @return uint32_t: The digits, 0 for the GMP default precision.
+         */
+        uint32_t                    FloatDigits() const;
+
+        /**
+         * Prints the Instructions of this Program to a string and returns it.
+         *
+         * @return std::string
+         */
+        std::string                 PrintToString() const;
+
+    private:
+        XProgram(const XProgram &);                 /* Not copyable. */
+        XProgram &operator =(const XProgram &);     /* Not assignable. */
+
+        std::vector<XInstruction>   m_Instructions; /**< The Instructions in execution order. */
+        std::vector<XAtom>          m_Constants;    /**< The constant pool. */
+        size_t                      m_cMaxDepth;    /**< Maximum operand stack depth. */
+        size_t                      m_cTemps;       /**< Number of temporaries. */
+        size_t                      m_cResults;     /**< Number of results left on the operand stack. */
+        bool                        m_fRegisters;   /**< Whether the Program was lowered for the register machine. */
+        std::vector<XRegInstruction> m_RegInstructions; /**< The register machine Instructions in execution order. */
+        std::vector<uint32_t>       m_RegOperands;  /**< Operand slots of the register machine Instructions. */
+        std::vector<uint32_t>       m_RegResults;   /**< Slots holding the results after running the register machine. */
+        size_t                      m_cRegisters;   /**< Number of registers used by the register machine. */
+        size_t                      m_cMaxParams;   /**< Maximum number of operands of a register machine Instruction. */
+        XJit                       *m_pJit;         /**< Native code for the Program, NULL if it must be interpreted. */
+        XFixedWidth                 m_FixedWidth;   /**< Width of the integers, if fixed. */
+        bool                        m_fDoubleTier;  /**< Whether the Program is evaluated in doubles first. */
+        std::vector<XBoundedDouble> m_DoubleConstants; /**< The constant pool in doubles, for the double tier. */
+        double                      m_rDoubleTolerance; /**< Relative error bound results of the double tier must meet. */
+        uint32_t                    m_cFloatDigits; /**< Significant decimal digits of float results, 0 for the GMP default. */
+        mp_bitcnt_t                 m_cFloatBits;   /**< Precision float results must be accurate to, 0 for the GMP default. */
+        friend class                XEvaluator;
+};
+
+#endif /* XANK_PROGRAM_H */
+
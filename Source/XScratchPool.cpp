@@ -0,0 +1,123 @@
+/** @file
+ * xank - Scratch Register Pool, implementation.
+ */
+
+/*
+ * Copyright (C) 2012 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "XScratchPool.h"
+#include "Assert.h"
+
+#include <new>
+
+XScratchPool::XScratchPool()
+    : m_cFloatBits(0)
+{
+    for (unsigned i = 0; i < XANK_SCRATCH_POOL_INITIAL_REGISTERS; i++)
+    {
+        mpz_ptr pInteger = AcquireInteger();
+        mpf_ptr pFloat   = AcquireFloat();
+        Assert(pInteger && pFloat);
+        NOREF(pInteger);
+        NOREF(pFloat);
+    }
+
+    /* Put them all on the free lists, in creation order. */
+    m_apFreeIntegers.assign(m_apIntegers.rbegin(), m_apIntegers.rend());
+    m_apFreeFloats.assign(m_apFloats.rbegin(), m_apFloats.rend());
+}
+
+
+XScratchPool::~XScratchPool()
+{
+    Assert(m_apFreeIntegers.size() == m_apIntegers.size());
+    Assert(m_apFreeFloats.size() == m_apFloats.size());
+
+    for (size_t i = 0; i < m_apIntegers.size(); i++)
+    {
+        mpz_clear(m_apIntegers[i]);
+        delete m_apIntegers[i];
+    }
+    for (size_t i = 0; i < m_apFloats.size(); i++)
+    {
+        mpf_clear(m_apFloats[i]);
+        delete m_apFloats[i];
+    }
+}
+
+
+mpz_ptr XScratchPool::AcquireInteger()
+{
+    if (!m_apFreeIntegers.empty())
+    {
+        mpz_ptr pInteger = m_apFreeIntegers.back();
+        m_apFreeIntegers.pop_back();
+        return pInteger;
+    }
+
+    mpz_ptr pInteger = new(std::nothrow) __mpz_struct;
+    if (!pInteger)
+        return NULL;
+    mpz_init(pInteger);
+    m_apIntegers.push_back(pInteger);
+    m_apFreeIntegers.reserve(m_apIntegers.size());  /* So ReleaseInteger() never needs to allocate. */
+    return pInteger;
+}
+
+
+void XScratchPool::ReleaseInteger(mpz_ptr pInteger)
+{
+    Assert(pInteger);
+    Assert(m_apFreeIntegers.size() < m_apIntegers.size());
+    m_apFreeIntegers.push_back(pInteger);
+}
+
+
+mpf_ptr XScratchPool::AcquireFloat()
+{
+    const mp_bitcnt_t cBits = m_cFloatBits ? m_cFloatBits : mpf_get_default_prec();
+    mpf_ptr pFloat;
+    if (!m_apFreeFloats.empty())
+    {
+        pFloat = m_apFreeFloats.back();
+        m_apFreeFloats.pop_back();
+
+        /* Only reallocates if the precision changed since the register was last used, GMP
+           rounds precisions up to whole limbs. */
+        if (   mpf_get_prec(pFloat) < cBits
+            || mpf_get_prec(pFloat) >= cBits + GMP_NUMB_BITS)
+            mpf_set_prec(pFloat, cBits);
+        return pFloat;
+    }
+
+    pFloat = new(std::nothrow) __mpf_struct;
+    if (!pFloat)
+        return NULL;
+    mpf_init2(pFloat, cBits);
+    m_apFloats.push_back(pFloat);
+    m_apFreeFloats.reserve(m_apFloats.size());      /* So ReleaseFloat() never needs to allocate. */
+    return pFloat;
+}
+
+
+void XScratchPool::ReleaseFloat(mpf_ptr pFloat)
+{
+    Assert(pFloat);
+    Assert(m_apFreeFloats.size() < m_apFloats.size());
+    m_apFreeFloats.push_back(pFloat);
+}
+
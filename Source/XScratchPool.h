@@ -0,0 +1,116 @@
+/** @file
+ * xank - Scratch Register Pool, header.
+ */
+
+/*
+ * Copyright (C) 2012 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XANK_SCRATCH_POOL_H
+# define XANK_SCRATCH_POOL_H
+
+#include <gmp.h>
+
+#include <vector>
+
+/** Number of registers of each kind initialized up front. */
+#define XANK_SCRATCH_POOL_INITIAL_REGISTERS     4
+
+/**
+ * A Scratch Register Pool.
+ * Hands out pre-initialized GMP integers and floats for temporaries so that
+ * Operator and Function implementations don't initialize and clear their own.
+ * Released registers keep their limbs, so once the pool has warmed up,
+ * evaluation does no GMP allocations for temporaries.
+ *
+ * Registers are acquired and released in LIFO order. The pool grows when all
+ * registers are in use and never shrinks.
+ */
+class XScratchPool
+{
+    public:
+        XScratchPool();
+        virtual ~XScratchPool();
+
+        /**
+         * Acquires an integer register. Its value is undefined.
+         *
+         * @return mpz_ptr: The register, NULL if out of memory.
+         */
+        mpz_ptr                     AcquireInteger();
+
+        /**
+         * Releases an integer register acquired using AcquireInteger().
+         *
+         * @param pInteger          The register.
+         */
+        void                        ReleaseInteger(mpz_ptr pInteger);
+
+        /**
+         * Acquires a float register with the float precision of the pool. Its value is
+         * undefined.
+         *
+         * @return mpf_ptr: The register, NULL if out of memory.
+         */
+        mpf_ptr                     AcquireFloat();
+
+        /**
+         * Sets the precision of float registers acquired from now on, which is also the
+         * precision Operators promote integers to floats with.
+         *
+         * @param cBits             The precision in bits, 0 for the GMP default precision.
+         */
+        void                        SetFloatPrecision(mp_bitcnt_t cBits);
+
+        /**
+         * Returns the precision set using SetFloatPrecision().
+         *
+         * @return mp_bitcnt_t: The precision in bits, 0 for the GMP default precision.
+         */
+        mp_bitcnt_t                 FloatPrecision() const;
+
+        /**
+         * Releases a float register acquired using AcquireFloat().
+         *
+         * @param pFloat            The register.
+         */
+        void                        ReleaseFloat(mpf_ptr pFloat);
+
+    private:
+        XScratchPool(const XScratchPool &);             /* Not copyable. */
+        XScratchPool &operator =(const XScratchPool &); /* Not assignable. */
+
+        std::vector<mpz_ptr>        m_apIntegers;       /**< All integer registers. */
+        std::vector<mpz_ptr>        m_apFreeIntegers;   /**< Integer registers not in use. */
+        std::vector<mpf_ptr>        m_apFloats;         /**< All float registers. */
+        std::vector<mpf_ptr>        m_apFreeFloats;     /**< Float registers not in use. */
+        mp_bitcnt_t                 m_cFloatBits;       /**< Precision of float registers, 0 for the GMP default. */
+};
+
+
+inline void XScratchPool::SetFloatPrecision(mp_bitcnt_t cBits)
+{
+    m_cFloatBits = cBits;
+}
+
+
+inline mp_bitcnt_t XScratchPool::FloatPrecision() const
+{
+    return m_cFloatBits;
+}
+
+#endif /* XANK_SCRATCH_POOL_H */
+
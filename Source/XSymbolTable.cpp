@@ -0,0 +1,147 @@
+/** @file
+ * xank - Symbol Table, implementation.
+ */
+
+/*
+ * Copyright (C) 2012 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "XSymbolTable.h"
+#include "XErrors.h"
+#include "Assert.h"
+
+#include <cctype>
+#include <cstring>
+
+/** Initial number of slots, must be a power of two. */
+#define XANK_SYMBOL_TABLE_INITIAL_SLOTS     16
+
+XSymbolTable::XSymbolTable()
+    : m_cSymbols(0)
+{
+    m_Slots.resize(XANK_SYMBOL_TABLE_INITIAL_SLOTS);     /* Value-initialized, i.e. all slots empty. */
+}
+
+
+XSymbolTable::~XSymbolTable()
+{
+}
+
+
+void XSymbolTable::Clear()
+{
+    m_Slots.assign(XANK_SYMBOL_TABLE_INITIAL_SLOTS, Slot());
+    m_sNames.clear();
+    m_cSymbols = 0;
+}
+
+
+/**
+ * FNV-1a hash of a name.
+ */
+uint32_t XSymbolTable::Hash(const char *pchName, size_t cchName)
+{
+    uint32_t uHash = UINT32_C(2166136261);
+    for (size_t i = 0; i < cchName; i++)
+    {
+        uHash ^= (unsigned char)pchName[i];
+        uHash *= UINT32_C(16777619);
+    }
+    return uHash;
+}
+
+
+void XSymbolTable::Grow()
+{
+    std::vector<Slot> OldSlots(m_Slots.size() * 2);
+    OldSlots.swap(m_Slots);
+
+    const size_t fMask = m_Slots.size() - 1;
+    for (size_t i = 0; i < OldSlots.size(); i++)
+    {
+        if (!OldSlots[i].cchName)
+            continue;
+
+        size_t idxSlot = OldSlots[i].uHash & fMask;
+        while (m_Slots[idxSlot].cchName)
+            idxSlot = (idxSlot + 1) & fMask;
+        m_Slots[idxSlot] = OldSlots[i];
+    }
+}
+
+
+int XSymbolTable::Insert(const char *pchName, size_t cchName, uint32_t uValue)
+{
+    AssertReturn(cchName > 0 && cchName < UINT32_MAX, ERR_INVALID_PARAMETER);
+
+    uint32_t uDummy;
+    if (Lookup(pchName, cchName, &uDummy))
+        return ERR_DUPLICATE_FUNCTOR;
+
+    /* Keep the load factor at or below a half so probe sequences stay short. */
+    if ((m_cSymbols + 1) * 2 > m_Slots.size())
+        Grow();
+
+    const uint32_t uHash = Hash(pchName, cchName);
+    const size_t fMask   = m_Slots.size() - 1;
+    size_t idxSlot       = uHash & fMask;
+    while (m_Slots[idxSlot].cchName)
+        idxSlot = (idxSlot + 1) & fMask;
+
+    m_Slots[idxSlot].uHash   = uHash;
+    m_Slots[idxSlot].uValue  = uValue;
+    m_Slots[idxSlot].offName = (uint32_t)m_sNames.length();
+    m_Slots[idxSlot].cchName = (uint32_t)cchName;
+    m_sNames.append(pchName, cchName);
+    ++m_cSymbols;
+    return INF_SUCCESS;
+}
+
+
+bool XSymbolTable::Lookup(const char *pchName, size_t cchName, uint32_t *puValue) const
+{
+    const uint32_t uHash = Hash(pchName, cchName);
+    const size_t fMask   = m_Slots.size() - 1;
+    size_t idxSlot       = uHash & fMask;
+    while (m_Slots[idxSlot].cchName)
+    {
+        const Slot *pcSlot = &m_Slots[idxSlot];
+        if (   pcSlot->uHash == uHash
+            && pcSlot->cchName == cchName
+            && !std::memcmp(m_sNames.data() + pcSlot->offName, pchName, cchName))
+        {
+            *puValue = pcSlot->uValue;
+            return true;
+        }
+        idxSlot = (idxSlot + 1) & fMask;
+    }
+    return false;
+}
+
+
+size_t XSymbolTable::IdentifierLength(const char *pcszStr)
+{
+    if (   !isalpha((unsigned char)*pcszStr)
+        && *pcszStr != '_')
+        return 0;
+
+    size_t cch = 1;
+    while (   isalnum((unsigned char)pcszStr[cch])
+           || pcszStr[cch] == '_')
+        cch++;
+    return cch;
+}
+
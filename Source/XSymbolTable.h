@@ -0,0 +1,105 @@
+/** @file
+ * xank - Symbol Table, header.
+ */
+
+/*
+ * Copyright (C) 2012 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XANK_SYMBOL_TABLE_H
+# define XANK_SYMBOL_TABLE_H
+
+#include <stdint.h>
+#include <cstddef>
+
+#include <string>
+#include <vector>
+
+/**
+ * A Symbol Table.
+ * An open addressing hash table of interned names, each mapped to a value.
+ * Lookups work directly on a span of the expression and never allocate.
+ */
+class XSymbolTable
+{
+    public:
+        XSymbolTable();
+        virtual ~XSymbolTable();
+
+        /**
+         * Removes all symbols.
+         */
+        void                        Clear();
+
+        /**
+         * Adds a symbol.
+         *
+         * @param pchName           The name, need not be zero terminated.
+         * @param cchName           Length of @a pchName in bytes.
+         * @param uValue            The value to associate with the name.
+         *
+         * @return int: xank error code, ERR_DUPLICATE_FUNCTOR if the name exists.
+         */
+        int                         Insert(const char *pchName, size_t cchName, uint32_t uValue);
+
+        /**
+         * Looks up a symbol.
+         *
+         * @param pchName           The name, need not be zero terminated.
+         * @param cchName           Length of @a pchName in bytes.
+         * @param puValue           Where to store the value associated with the name.
+         *
+         * @return bool: true if found, false otherwise.
+         */
+        bool                        Lookup(const char *pchName, size_t cchName, uint32_t *puValue) const;
+
+        /**
+         * Returns the length of the identifier at the start of a string, an
+         * identifier being a letter or underscore followed by letters, digits or
+         * underscores.
+         *
+         * @param pcszStr           The string.
+         *
+         * @return size_t: Length of the identifier in bytes, 0 if there is none.
+         */
+        static size_t               IdentifierLength(const char *pcszStr);
+
+    private:
+        /**
+         * A hash table slot.
+         */
+        typedef struct Slot
+        {
+            /** The hash of the name. */
+            uint32_t                uHash;
+            /** The value, only valid when cchName is not 0. */
+            uint32_t                uValue;
+            /** Offset of the name in the name pool. */
+            uint32_t                offName;
+            /** Length of the name in bytes, 0 for an empty slot. */
+            uint32_t                cchName;
+        } Slot;
+
+        static uint32_t             Hash(const char *pchName, size_t cchName);
+        void                        Grow();
+
+        std::vector<Slot>           m_Slots;        /**< The slots, always a power of two in size. */
+        std::string                 m_sNames;       /**< Pool of the interned names. */
+        size_t                      m_cSymbols;     /**< Number of symbols in the table. */
+};
+
+#endif /* XANK_SYMBOL_TABLE_H */
+
@@ -0,0 +1,356 @@
+/** @file
+ * xank - Self-test, implementation.
+ */
+
+/*
+ * Copyright (C) 2012 Ramshankar (aka Teknomancer)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Evaluates every test expression with each optimization and compares the results with
+ * the ones of the unoptimized stack machine, and with the expected value. Run it with
+ * "make test".
+ */
+
+#include "XEvaluator.h"
+#include "XEvaluatorDefs.h"
+#include "XAtom.h"
+#include "XProgram.h"
+#include "ConsoleIO.h"
+#include "Settings.h"
+#include "XErrors.h"
+#include "XGenericDefs.h"
+
+#include <gmp.h>
+#include <cmath>
+
+/**
+ * A way of evaluating Programs, the optimizations it enables.
+ */
+typedef struct XTestConfig
+{
+    /** Name of the configuration, for failure messages. */
+    const char             *pcszName;
+    bool                    fFold;
+    bool                    fCse;
+    bool                    fTypes;
+    bool                    fFuse;
+    bool                    fSuper;
+    bool                    fRegisters;
+    bool                    fNative;
+    bool                    fDoubleTier;
+} XTestConfig;
+
+/**
+ * A test expression and how to parse it.
+ */
+typedef struct XTestCase
+{
+    /** The expression. */
+    const char             *pcszExpr;
+    /** Width of the integers, see XANK_SETTING_INTEGER_WIDTH. */
+    const char             *pcszWidth;
+    /** Whether fixed-width integers saturate. */
+    bool                    fSaturate;
+    /** Significant decimal digits of float results, 0 for the GMP default. */
+    uint32_t                cFloatDigits;
+    /** The expected result in decimal, exact for integers and to the digits for floats. */
+    const char             *pcszExpected;
+} XTestCase;
+
+/** The unoptimized stack machine, which every other configuration must agree with. */
+static const XTestConfig g_Reference = { "unoptimized", false, false, false, false, false, false, false, false };
+
+static const XTestConfig g_aConfigs[] =
+{
+    { "folding",            true,  false, false, false, false, false, false, false },
+    { "cse",                false, true,  false, false, false, false, false, false },
+    { "typing",             false, false, true,  false, false, false, false, false },
+    { "fusion",             false, false, false, true,  false, false, false, false },
+    { "typing+fusion",      false, false, true,  true,  false, false, false, false },
+    { "superinstructions",  false, false, false, false, true,  false, false, false },
+    { "register machine",   false, false, false, false, false, true,  false, false },
+    { "native code",        false, false, false, false, false, false, true,  false },
+    { "double tier",        false, false, false, false, false, false, false, true  },
+    { "defaults",           true,  true,  true,  true,  true,  false, true,  false },
+    { "defaults+registers", true,  true,  true,  true,  true,  true,  true,  false },
+    { "all",                true,  true,  true,  true,  true,  true,  true,  true  }
+};
+
+static const XTestCase g_aCases[] =
+{
+    /* Arbitrary precision integers. */
+    { "1 + 42 + 10",                                    "",    false, 0,  "53" },
+    { "(1 + 2) + (1 + 2) + 3",                          "",    false, 0,  "9" },
+    { "9223372036854775807 + 1",                        "",    false, 0,  "9223372036854775808" },
+
+    /* Power-of-two radix literals around 2^63. */
+    { "0x7fffffffffffffff",                             "",    false, 0,  "9223372036854775807" },
+    { "0x7fffffffffffffff + 1",                         "",    false, 0,  "9223372036854775808" },
+    { "0x8000000000000000",                             "",    false, 0,  "9223372036854775808" },
+    { "0x8000000000000000 + 0x8000000000000000",        "",    false, 0,  "18446744073709551616" },
+    { "0xffffffffffffffff + 1",                         "",    false, 0,  "18446744073709551616" },
+    { "0x00000000000000008000000000000000",             "",    false, 0,  "9223372036854775808" },
+    { "b111111111111111111111111111111111111111111111111111111111111111",
+                                                        "",    false, 0,  "9223372036854775807" },
+    { "b1000000000000000000000000000000000000000000000000000000000000000",
+                                                        "",    false, 0,  "9223372036854775808" },
+    { "0777777777777777777777",                         "",    false, 0,  "9223372036854775807" },
+    { "01000000000000000000000 + 0777777777777777777777", "",  false, 0,  "18446744073709551615" },
+
+    /* Fixed-width integers wrapping at the boundaries. */
+    { "255 + 1",                                        "u8",  false, 0,  "0" },
+    { "200 + 100 + 1",                                  "u8",  false, 0,  "45" },
+    { "(250 + 10) + (250 + 10)",                        "u8",  false, 0,  "8" },
+    { "127 + 1",                                        "i8",  false, 0,  "-128" },
+    { "127 + 1 + 1",                                    "i8",  false, 0,  "-127" },
+    { "255 + 1",                                        "i8",  false, 0,  "0" },
+    { "18446744073709551615 + 1",                       "u64", false, 0,  "0" },
+    { "0xffffffffffffffff + 2",                         "u64", false, 0,  "1" },
+    { "9223372036854775807 + 1",                        "i64", false, 0,  "-9223372036854775808" },
+    { "0x7fffffffffffffff + 1 + 1",                     "i64", false, 0,  "-9223372036854775807" },
+    { "18446744073709551615 + 1",                       "i64", false, 0,  "0" },
+
+    /* Fixed-width integers saturating at the boundaries. */
+    { "255 + 1",                                        "u8",  true,  0,  "255" },
+    { "254 + 1",                                        "u8",  true,  0,  "255" },
+    { "200 + 100 + 1",                                  "u8",  true,  0,  "255" },
+    { "127 + 1",                                        "i8",  true,  0,  "127" },
+    { "100 + 27 + 1 + (1 + 1)",                         "i8",  true,  0,  "127" },
+    { "255 + 1",                                        "i8",  true,  0,  "127" },
+    { "18446744073709551615 + 1",                       "u64", true,  0,  "18446744073709551615" },
+    { "9223372036854775807 + 1",                        "i64", true,  0,  "9223372036854775807" },
+    { "(9223372036854775807 + 1) + (9223372036854775807 + 1)",
+                                                        "i64", true,  0,  "9223372036854775807" },
+
+    /* Floats, with and without a precision. */
+    { "0.1 + 0.2",                                      "",    false, 0,  "0.3" },
+    { "0.1 + 0.2",                                      "",    false, 5,  "0.3" },
+    { "1 + 0.5",                                        "",    false, 5,  "1.5" },
+    { "0.1 + 0.2 + 0.3 + 0.4 + 0.5 + 0.6",              "",    false, 18, "2.1" },
+    { "1 + 0.1 + 2 + 0.2 + 3 + 0.3 + 4",                "",    false, 36, "10.6" },
+    { "(0.1 + 0.2) + (0.1 + 0.2) + 0.7",                "",    false, 40, "1.3" },
+    { "1 + (2 + 0.3) + (2 + 0.3)",                      "",    false, 17, "5.6" },
+    { "1088685905973025572400 + 104.632 + 2",           "",    false, 5,  "1088685905973025572506.632" },
+    { "123456789012345678901234567890.5 + 0.25",        "",    false, 40, "123456789012345678901234567890.75" }
+};
+
+
+/**
+ * Returns the value of an integer Atom.
+ *
+ * @param pcAtom            The integer Atom.
+ * @param pValue            Where to store the value, initialized.
+ */
+static void AtomToInteger(const XAtom *pcAtom, mpz_ptr pValue)
+{
+    if (pcAtom->IsSmallInteger())
+    {
+        /* Not mpz_set_si(), a long may be narrower. */
+        const int64_t iValue  = pcAtom->SmallInteger();
+        const uint64_t uValue = iValue < 0 ? 0 - (uint64_t)iValue : (uint64_t)iValue;
+        mpz_set_ui(pValue, (unsigned long)(uValue >> 32));
+        mpz_mul_2exp(pValue, pValue, 32);
+        mpz_add_ui(pValue, pValue, (unsigned long)(uValue & UINT32_MAX));
+        if (iValue < 0)
+            mpz_neg(pValue, pValue);
+    }
+    else
+        mpz_set(pValue, pcAtom->BigInteger());
+}
+
+
+/**
+ * Returns whether two floats agree to the given number of significant decimal digits.
+ *
+ * @param pcLeft            The one float.
+ * @param pcRight           The other float, not zero.
+ * @param cDigits           The number of digits.
+ *
+ * @return bool: true if they agree, false otherwise.
+ */
+static bool FloatsAgree(mpf_srcptr pcLeft, mpf_srcptr pcRight, uint32_t cDigits)
+{
+    mpf_t Diff;
+    mpf_init2(Diff, XANK_MAX(mpf_get_prec(pcLeft), mpf_get_prec(pcRight)));
+    mpf_reldiff(Diff, pcRight, pcLeft);
+    mpf_abs(Diff, Diff);
+    const bool fAgree = mpf_get_d(Diff) <= std::pow(10.0, -(double)cDigits);
+    mpf_clear(Diff);
+    return fAgree;
+}
+
+
+/**
+ * Parses a test expression with a configuration and evaluates it twice, the second
+ * result must be the same as the first.
+ *
+ * @param Eval              The evaluator.
+ * @param pcConfig          The configuration.
+ * @param pcCase            The test expression.
+ * @param pResult           Where to store the result.
+ *
+ * @return int: xank error code.
+ */
+static int Run(XEvaluator &Eval, const XTestConfig *pcConfig, const XTestCase *pcCase, XAtom *pResult)
+{
+    Settings *pSettings = Eval.EvaluatorSettings();
+    pSettings->SetBool(XANK_SETTING_CONSTANT_FOLDING,      pcConfig->fFold);
+    pSettings->SetBool(XANK_SETTING_COMMON_SUBEXPRESSIONS, pcConfig->fCse);
+    pSettings->SetBool(XANK_SETTING_TYPE_SPECIALIZATION,   pcConfig->fTypes);
+    pSettings->SetBool(XANK_SETTING_OPERATOR_FUSION,       pcConfig->fFuse);
+    pSettings->SetBool(XANK_SETTING_SUPERINSTRUCTIONS,     pcConfig->fSuper);
+    pSettings->SetBool(XANK_SETTING_REGISTER_MACHINE,      pcConfig->fRegisters);
+    pSettings->SetBool(XANK_SETTING_NATIVE_CODE,           pcConfig->fNative);
+    pSettings->SetBool(XANK_SETTING_DOUBLE_TIER,           pcConfig->fDoubleTier);
+    pSettings->SetString(XANK_SETTING_INTEGER_WIDTH,       pcCase->pcszWidth);
+    pSettings->SetBool(XANK_SETTING_INTEGER_SATURATION,    pcCase->fSaturate);
+
+    XProgram *pProgram = NULL;
+    int rc = Eval.Parse(pcCase->pcszExpr, pcCase->cFloatDigits, &pProgram);
+    if (IS_FAILURE(rc))
+        return rc;
+
+    XAtom Again;
+    rc = Eval.Evaluate(pProgram, pResult);
+    if (IS_SUCCESS(rc))
+        rc = Eval.Evaluate(pProgram, &Again);
+    if (   IS_SUCCESS(rc)
+        && pResult->PrintToString() != Again.PrintToString())
+        rc = ERR_GENERAL_FAILURE;
+    delete pProgram;
+    return rc;
+}
+
+
+/**
+ * Checks a result against the reference result and the expected value.
+ *
+ * @param Console           Where to report failures.
+ * @param pcConfig          The configuration the result was computed with.
+ * @param pcCase            The test expression.
+ * @param pcResult          The result.
+ * @param pcReference       The result of the unoptimized stack machine.
+ *
+ * @return bool: true if the result is right, false otherwise.
+ */
+static bool Check(ConsoleIO &Console, const XTestConfig *pcConfig, const XTestCase *pcCase, const XAtom *pcResult,
+                  const XAtom *pcReference)
+{
+    bool fOk = false;
+    if (   pcResult->IsInteger()
+        && pcReference->IsInteger())
+    {
+        mpz_t Result;
+        mpz_t Reference;
+        mpz_t Expected;
+        mpz_init(Result);
+        mpz_init(Reference);
+        mpz_init(Expected);
+        AtomToInteger(pcResult, Result);
+        AtomToInteger(pcReference, Reference);
+        fOk =    !mpz_set_str(Expected, pcCase->pcszExpected, 10)
+              && !mpz_cmp(Result, Reference)
+              && !mpz_cmp(Result, Expected);
+        mpz_clear(Expected);
+        mpz_clear(Reference);
+        mpz_clear(Result);
+    }
+    else if (   pcResult->IsFloat()
+             && pcReference->IsFloat())
+    {
+        /*
+         * The passes keep the planned precisions, so they give the same value in the same
+         * precision. Not so the double tier, it only has to be as accurate.
+         */
+        const uint32_t cDigits = pcCase->cFloatDigits ? pcCase->cFloatDigits : 15;
+        mpf_t Expected;
+        mpf_init2(Expected, XANK_MAX(mpf_get_prec(pcResult->Float()), 64));
+        fOk = !mpf_set_str(Expected, pcCase->pcszExpected, 10);
+        if (pcConfig->fDoubleTier)
+            fOk = fOk && FloatsAgree(pcResult->Float(), pcReference->Float(), cDigits - 1);
+        else
+        {
+            fOk =    fOk
+                  && mpf_get_prec(pcResult->Float()) == mpf_get_prec(pcReference->Float())
+                  && !mpf_cmp(pcResult->Float(), pcReference->Float());
+        }
+        fOk = fOk && FloatsAgree(pcResult->Float(), Expected, cDigits);
+        mpf_clear(Expected);
+    }
+
+    if (!fOk)
+    {
+        Console.ColorPrintf(enmConsoleColorRed, "FAILED: [%s] width '%s'%s digits %" FMT_U32 " with %s: %s, "
+                            "unoptimized %s, expected %s\n", pcCase->pcszExpr, pcCase->pcszWidth,
+                            pcCase->fSaturate ? " saturating" : "", pcCase->cFloatDigits, pcConfig->pcszName,
+                            pcResult->PrintToString().c_str(), pcReference->PrintToString().c_str(),
+                            pcCase->pcszExpected);
+    }
+    return fOk;
+}
+
+
+int main(int argc, char **argv)
+{
+    NOREF(argc); NOREF(argv);
+    ConsoleIO Console;
+    XEvaluator Eval;
+    int rc = Eval.Init();
+    if (IS_FAILURE(rc))
+    {
+        Console.ErrorPrintf(rc, "Evaluator initilization failed.\n");
+        return 1;
+    }
+
+    size_t cFailed = 0;
+    size_t cChecks = 0;
+    for (size_t i = 0; i < XANK_ARRAY_ELEMENTS(g_aCases); i++)
+    {
+        const XTestCase *pcCase = &g_aCases[i];
+        XAtom Reference;
+        rc = Run(Eval, &g_Reference, pcCase, &Reference);
+        if (IS_FAILURE(rc))
+        {
+            Console.ErrorPrintf(rc, "FAILED: [%s] unoptimized\n", pcCase->pcszExpr);
+            ++cFailed;
+            continue;
+        }
+
+        for (size_t k = 0; k < XANK_ARRAY_ELEMENTS(g_aConfigs); k++)
+        {
+            const XTestConfig *pcConfig = &g_aConfigs[k];
+            XAtom Result;
+            rc = Run(Eval, pcConfig, pcCase, &Result);
+            ++cChecks;
+            if (IS_FAILURE(rc))
+            {
+                Console.ErrorPrintf(rc, "FAILED: [%s] with %s\n", pcCase->pcszExpr, pcConfig->pcszName);
+                ++cFailed;
+            }
+            else if (!Check(Console, pcConfig, pcCase, &Result, &Reference))
+                ++cFailed;
+        }
+    }
+
+    if (cFailed)
+    {
+        Console.ColorPrintf(enmConsoleColorRed, "%" FMT_SZT " of %" FMT_SZT " checks failed.\n", cFailed, cChecks);
+        return 1;
+    }
+    Console.ColorPrintf(enmConsoleColorGreen, "All %" FMT_SZT " checks passed.\n", cChecks);
+    return 0;
+}